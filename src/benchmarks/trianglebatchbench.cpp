@@ -0,0 +1,179 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/mat2x2.hpp>
+#include <glm/mat3x3.hpp>
+#include "geometric/trianglebatch.h"
+
+using glm::vec2;
+using glm::vec3;
+using glm::mat2;
+using glm::mat3;
+
+//compares per-triangle update of world data, as done by CMesh::STriangle2D, with CTriangleBatch;
+//batch side also copies results back into triangles, as CMesh::STriGroup::UpdateWorldData does
+namespace
+{
+//same layout as CMesh::STriangle2D, so that cache behaviour is comparable
+struct STriangleAoS
+{
+    std::size_t   id;
+    vec2          vtx[3];
+    vec2          vtxR[3];
+    vec2          vtxRT[3];
+    vec2          norm[3];
+    vec2          normR[3];
+    bool          flapSharp[3];
+    float         edgeLen[3];
+    void*         group;
+    vec2          position;
+    float         rotation;
+    float         angleOY[3];
+    mat3          relativeMx;
+    void*         edges[3];
+    std::uint64_t visitEpoch;
+    std::uint64_t transformRevision;
+
+    void GroupHasTransformed(const mat3& parMx)
+    {
+        mat3 newMx = parMx * relativeMx;
+        newMx[0][0] = glm::clamp(newMx[0][0], -1.0f, 1.0f);
+        newMx[1][0] = glm::clamp(newMx[1][0], -1.0f, 1.0f);
+        newMx[1][1] = glm::clamp(newMx[1][1], -1.0f, 1.0f);
+        newMx[0][1] = glm::clamp(newMx[0][1], -1.0f, 1.0f);
+
+        position = vec2(newMx[2][0], newMx[2][1]);
+        mat2 rotMx;
+        rotMx[0] = vec2(newMx[0][0], newMx[0][1]);
+        rotMx[1] = vec2(newMx[1][0], newMx[1][1]);
+        rotation = glm::degrees(glm::acos(newMx[0][0])*glm::sign(glm::asin(newMx[0][1])));
+        for(int i=0; i<3; ++i)
+        {
+            normR[i] = rotMx*norm[i];
+            vtxR[i] = rotMx*vtx[i];
+            vtxRT[i] = vtxR[i]+position;
+        }
+    }
+};
+
+mat3 RandomFrame(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> offset(-100.0f, 100.0f);
+    const float a = angle(rng);
+    mat3 mx(1.0f);
+    mx[0] = vec3(glm::cos(a), glm::sin(a), 0.0f);
+    mx[1] = vec3(-glm::sin(a), glm::cos(a), 0.0f);
+    mx[2] = vec3(offset(rng), offset(rng), 1.0f);
+    return mx;
+}
+
+template<typename TFunc>
+double MeasureMs(int iterations, TFunc&& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for(int i=0; i<iterations; ++i)
+        func(i);
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t numTris = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 30000;
+    const int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coord(-5.0f, 5.0f);
+
+    std::vector<STriangleAoS> tris(numTris);
+    CTriangleBatch batch;
+    batch.Reserve(numTris);
+    for(STriangleAoS& t : tris)
+    {
+        for(int v=0; v<3; ++v)
+        {
+            t.vtx[v] = vec2(coord(rng), coord(rng));
+            t.norm[v] = glm::normalize(vec2(coord(rng), coord(rng)) + vec2(0.001f));
+        }
+        t.relativeMx = RandomFrame(rng);
+        batch.Add(t.relativeMx, t.vtx, t.norm);
+    }
+    std::vector<STriangleAoS> batchTris(tris);
+
+    std::vector<mat3> groupMatrices;
+    for(int i=0; i<iterations; ++i)
+        groupMatrices.push_back(RandomFrame(rng));
+
+    const double aosMs = MeasureMs(iterations, [&](int i)
+    {
+        for(STriangleAoS& t : tris)
+            t.GroupHasTransformed(groupMatrices[i]);
+    });
+    const double kernelMs = MeasureMs(iterations, [&](int i)
+    {
+        batch.Transform(groupMatrices[i]);
+    });
+    const double batchMs = MeasureMs(iterations, [&](int i)
+    {
+        batch.Transform(groupMatrices[i]);
+        for(std::size_t j=0; j<numTris; ++j)
+        {
+            STriangleAoS& t = batchTris[j];
+            t.position = batch.GetPosition(j);
+            t.rotation = batch.GetRotation(j);
+            for(int v=0; v<3; ++v)
+            {
+                t.vtxR[v] = batch.GetRotatedVertex(j, v);
+                t.vtxRT[v] = batch.GetTransformedVertex(j, v);
+                t.normR[v] = batch.GetRotatedNormal(j, v);
+            }
+            t.transformRevision = i;
+        }
+    });
+
+    //both hold results for the last matrix now
+    float maxDiff = 0.0f;
+    for(std::size_t i=0; i<numTris; ++i)
+    {
+        maxDiff = glm::max(maxDiff, glm::abs(tris[i].rotation - batchTris[i].rotation));
+        for(int v=0; v<3; ++v)
+        {
+            const vec2 d1 = tris[i].vtxRT[v] - batchTris[i].vtxRT[v];
+            const vec2 d2 = tris[i].normR[v] - batchTris[i].normR[v];
+            maxDiff = glm::max(maxDiff, glm::max(glm::max(glm::abs(d1.x), glm::abs(d1.y)),
+                                                 glm::max(glm::abs(d2.x), glm::abs(d2.y))));
+        }
+    }
+
+    std::printf("triangles: %zu, iterations: %d\n", numTris, iterations);
+    std::printf("per-triangle:  %.3f ms/sweep\n", aosMs);
+    std::printf("batch kernel:  %.3f ms/sweep (%.2fx)\n", kernelMs, aosMs / kernelMs);
+    std::printf("batch + copy:  %.3f ms/sweep (%.2fx)\n", batchMs, aosMs / batchMs);
+    std::printf("max difference: %g\n", maxDiff);
+    return maxDiff == 0.0f ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QDir>
+#include <QProcess>
+#include <QThread>
+#include <cstdio>
+#include <clocale>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include "cli/sheetpainter.h"
+#include "ivo/ivoloader.h"
+#include "pdo/pdoloader.h"
+#include "pdo/pdotools.h"
+#include "settings/settings.h"
+#include "mesh/mesh.h"
+
+namespace
+{
+struct SOptions
+{
+    QString outputDir;
+    bool    saveIvo;
+    bool    jsonIvo;
+    bool    exportSheets;
+    bool    pack;
+};
+
+//options, that are forwarded as-is to child processes
+const char* const g_ValueOptions[] = { "output", "detach-angle", "paper", "margins", "resolution-scale", "format", "quality", "line-width", "packing" };
+const char* const g_FlagOptions[]  = { "ivo", "json", "sheets", "pack" };
+
+void ApplySettings(const QCommandLineParser& parser)
+{
+    CSettings& sett = CSettings::GetInstance();
+
+    bool ok = true;
+    auto toUInt = [&ok](const QString& str)
+    {
+        bool conv = false;
+        const unsigned val = str.toUInt(&conv);
+        ok = ok && conv;
+        return val;
+    };
+    auto toPair = [&ok, &toUInt](const QString& str, unsigned& a, unsigned& b)
+    {
+        const QStringList parts = str.split('x');
+        if(parts.size() != 2)
+        {
+            ok = false;
+            return;
+        }
+        a = toUInt(parts[0]);
+        b = toUInt(parts[1]);
+    };
+
+    if(parser.isSet("detach-angle"))
+        sett.SetDetachAngle(static_cast<unsigned char>(toUInt(parser.value("detach-angle"))));
+    if(parser.isSet("paper"))
+    {
+        unsigned w = 0u, h = 0u;
+        toPair(parser.value("paper"), w, h);
+        if(ok && w > 0u && h > 0u)
+        {
+            sett.SetPaperWidth(w);
+            sett.SetPaperHeight(h);
+        }
+    }
+    if(parser.isSet("margins"))
+    {
+        unsigned mh = 0u, mv = 0u;
+        toPair(parser.value("margins"), mh, mv);
+        if(ok && mh > 0u && mv > 0u)
+        {
+            sett.SetMarginsHorizontal(mh);
+            sett.SetMarginsVertical(mv);
+        }
+    }
+    if(parser.isSet("resolution-scale"))
+    {
+        const float scale = parser.value("resolution-scale").toFloat(&ok);
+        if(ok && scale >= 1.0f)
+            sett.SetResolutionScale(scale);
+    }
+    if(parser.isSet("format"))
+    {
+        const QString format = parser.value("format").toLower();
+        if(format == "png")
+            sett.SetImageFormat(CSettings::IF_PNG);
+        else if(format == "jpg")
+            sett.SetImageFormat(CSettings::IF_JPG);
+        else if(format == "bmp")
+            sett.SetImageFormat(CSettings::IF_BMP);
+        else
+            ok = false;
+    }
+    if(parser.isSet("packing"))
+    {
+        const QString packing = parser.value("packing").toLower();
+        if(packing == "shelves")
+            sett.SetPackingAlgorithm(CSettings::PA_FCNR);
+        else if(packing == "maxrects")
+            sett.SetPackingAlgorithm(CSettings::PA_MAXRECTS);
+        else if(packing == "skyline")
+            sett.SetPackingAlgorithm(CSettings::PA_SKYLINE);
+        else if(packing == "nesting")
+            sett.SetPackingAlgorithm(CSettings::PA_NESTING);
+        else
+            ok = false;
+    }
+    if(parser.isSet("quality"))
+    {
+        const unsigned quality = toUInt(parser.value("quality"));
+        if(ok && quality <= 100u)
+            sett.SetImageQuality(static_cast<unsigned char>(quality));
+    }
+    if(parser.isSet("line-width"))
+    {
+        const float lineWidth = parser.value("line-width").toFloat(&ok);
+        if(ok && lineWidth >= 0.1f)
+            sett.SetLineWidth(lineWidth);
+    }
+
+    if(!ok)
+        throw std::runtime_error("Invalid value of one of options");
+}
+
+SModelData LoadModel(const QString& path)
+{
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if(suffix == "ivo")
+        return IvoLoader::LoadFromIVO(path);
+
+    if(suffix == "pdo")
+    {
+        if(PdoTools::GetVersionPDO(path) != 20)
+            throw std::runtime_error("Unsupported PDO format version!");
+        return PdoTools::LoadPDOv2_0(path);
+    }
+
+    SModelData data;
+    data.mesh.reset(new CMesh());
+    data.mesh->LoadMesh(path.toStdString());
+    return data;
+}
+
+void ProcessFile(const QString& path, const SOptions& opts, const QCommandLineParser& parser)
+{
+    //detach angle must be known before import, paper settings override the ones stored in file
+    ApplySettings(parser);
+    SModelData data = LoadModel(path);
+    IvoLoader::ApplyStoredSettings(data);
+    ApplySettings(parser);
+
+    if(opts.pack)
+        data.mesh->PackGroups(false);
+
+    const QString baseName = QDir(opts.outputDir).filePath(QFileInfo(path).completeBaseName());
+
+    if(opts.saveIvo)
+        IvoLoader::SaveToIVO(baseName + ".ivo", *data.mesh, data.texturePaths, data.textureImages,
+                             opts.jsonIvo ? IvoLoader::F_JSON : IvoLoader::F_BINARY);
+
+    if(opts.exportSheets)
+    {
+        const CSettings& sett = CSettings::GetInstance();
+        QString imgFormat = "PNG";
+        switch(sett.GetImageFormat())
+        {
+            case CSettings::IF_BMP : imgFormat = "BMP"; break;
+            case CSettings::IF_JPG : imgFormat = "JPG"; break;
+            case CSettings::IF_PNG : imgFormat = "PNG"; break;
+            default: break;
+        }
+
+        const CSheetPainter painter(*data.mesh, data.textureImages);
+        const std::vector<glm::vec2> sheets = painter.GetOccupiedSheets();
+        for(std::size_t i=0; i<sheets.size(); ++i)
+        {
+            const QImage img = painter.DrawImageFromSheet(sheets[i]);
+            if(!img.save(baseName + "_" + QString::number(i+1) + "." + imgFormat.toLower(),
+                         imgFormat.toStdString().c_str(),
+                         sett.GetImageQuality()))
+                throw std::runtime_error("Failed to save one of image files!");
+        }
+    }
+}
+
+//every file is processed by a separate instance of ivo-cli, because settings stored in a loaded file
+//are applied to the process-wide CSettings, which the rest of that file's processing reads
+int ProcessInParallel(const QStringList& inputs, const QCommandLineParser& parser, int jobs)
+{
+    QStringList commonArgs;
+    for(const char* opt : g_ValueOptions)
+        if(parser.isSet(opt))
+            commonArgs << QString("--") + opt << parser.value(opt);
+    for(const char* opt : g_FlagOptions)
+        if(parser.isSet(opt))
+            commonArgs << QString("--") + opt;
+    commonArgs << "--jobs" << "1";
+
+    int failed = 0;
+    int next = 0;
+    std::list<std::unique_ptr<QProcess>> running;
+    while(next < inputs.size() || !running.empty())
+    {
+        while(next < inputs.size() && static_cast<int>(running.size()) < jobs)
+        {
+            std::unique_ptr<QProcess> proc(new QProcess());
+            proc->setProcessChannelMode(QProcess::ForwardedChannels);
+            proc->start(QCoreApplication::applicationFilePath(), QStringList(commonArgs) << inputs[next++]);
+            running.push_back(std::move(proc));
+        }
+
+        for(auto it = running.begin(); it != running.end();)
+        {
+            QProcess& proc = **it;
+            if(proc.state() != QProcess::NotRunning && !proc.waitForFinished(20))
+            {
+                ++it;
+                continue;
+            }
+            //process that failed to start is not running either, but reports normal exit with code 0
+            if(proc.error() == QProcess::FailedToStart)
+            {
+                std::fprintf(stderr, "%s: %s\n", qPrintable(proc.arguments().last()), qPrintable(proc.errorString()));
+                ++failed;
+            }
+            else if(proc.exitStatus() != QProcess::NormalExit || proc.exitCode() != 0)
+                ++failed;
+            it = running.erase(it);
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    CSettings::SetPersistent(false);
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ivo-cli");
+    std::setlocale(LC_NUMERIC, "C");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Unfolds 3D models into papercraft patterns without GUI.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "Models to process (*.ivo, *.pdo or any format supported by importer).", "<files...>");
+    parser.addOptions({
+        {{"o", "output"},       "Directory for output files (default: current).", "dir", "."},
+        {"ivo",                 "Save unfolded model as <name>.ivo (default if nothing else is requested)."},
+        {"json",                "Save .ivo files in JSON format, readable by older versions."},
+        {"sheets",              "Export paper sheets as <name>_<N>.<format>."},
+        {"pack",                "Re-pack parts of loaded .ivo and .pdo files."},
+        {"packing",             "Packing algorithm: shelves, maxrects, skyline or nesting (by real outlines).", "name"},
+        {{"j", "jobs"},         "Number of files processed simultaneously (default: number of cores).", "n"},
+        {"detach-angle",        "Maximal angle between neighbouring faces in one part, degrees.", "deg"},
+        {"paper",               "Paper size, millimeters.", "WxH"},
+        {"margins",             "Paper margins, millimeters.", "HxV"},
+        {"resolution-scale",    "Pixels per millimeter of exported sheets.", "scale"},
+        {"format",              "Image format: png, jpg or bmp.", "format"},
+        {"quality",             "Image quality, 0-100.", "quality"},
+        {"line-width",          "Width of lines on sheets.", "width"}
+    });
+    parser.process(app);
+
+    const QStringList inputs = parser.positionalArguments();
+    if(inputs.isEmpty())
+        parser.showHelp(1);
+
+    SOptions opts;
+    opts.outputDir = parser.value("output");
+    opts.exportSheets = parser.isSet("sheets");
+    opts.saveIvo = parser.isSet("ivo") || !opts.exportSheets;
+    opts.jsonIvo = parser.isSet("json");
+    opts.pack = parser.isSet("pack");
+
+    if(!QDir().mkpath(opts.outputDir))
+    {
+        std::fprintf(stderr, "Failed to create output directory '%s'\n", qPrintable(opts.outputDir));
+        return 1;
+    }
+
+    int jobs = QThread::idealThreadCount();
+    if(parser.isSet("jobs"))
+        jobs = parser.value("jobs").toInt();
+    if(jobs > 1 && inputs.size() > 1)
+        return ProcessInParallel(inputs, parser, jobs);
+
+    int result = 0;
+    for(const QString& input : inputs)
+    {
+        try
+        {
+            ProcessFile(input, opts, parser);
+            std::printf("%s: done\n", qPrintable(input));
+        } catch(std::exception& e)
+        {
+            std::fprintf(stderr, "%s: %s\n", qPrintable(input), e.what());
+            result = 1;
+        }
+        std::fflush(stdout);
+    }
+    return result;
+}
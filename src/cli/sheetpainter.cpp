@@ -0,0 +1,306 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <QPainter>
+#include <QPolygonF>
+#include <QTransform>
+#include <QVector>
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+#include <algorithm>
+#include <cassert>
+#include "cli/sheetpainter.h"
+#include "settings/settings.h"
+
+namespace
+{
+inline QPointF ToQt(const glm::vec2& v)
+{
+    return QPointF(v.x, v.y);
+}
+
+//dash pattern of fold texture (see IRenderer2D::CreateFoldTextures), in 1/16 of stipple period
+QVector<qreal> GetFoldPattern(int foldType, qreal period, qreal penWidth, qreal& offset)
+{
+    const qreal texel = period / 16.0 / penWidth;
+    QVector<qreal> pattern;
+    switch(foldType)
+    {
+    case CMesh::SEdge::FT_VALLEY:
+        pattern << 10.0*texel << 6.0*texel;
+        break;
+    case CMesh::SEdge::FT_MOUNTAIN:
+        pattern << 10.0*texel << 3.0*texel << 1.0*texel << 2.0*texel;
+        break;
+    default:
+        break;
+    }
+    //texture starts with a gap
+    offset = 10.0*texel;
+    return pattern;
+}
+}
+
+CSheetPainter::CSheetPainter(const CMesh& mdl, const std::unordered_map<unsigned, std::unique_ptr<QImage>>& textures) :
+    m_model(mdl),
+    m_textures(textures)
+{
+}
+
+std::vector<glm::vec2> CSheetPainter::GetOccupiedSheets() const
+{
+    std::vector<glm::vec2> sheets;
+
+    const CSettings& sett = CSettings::GetInstance();
+    const unsigned papHeight = sett.GetPaperHeight();
+    const unsigned papWidth = sett.GetPaperWidth();
+    const glm::vec2 rightBottom = m_model.GetAABBox2D().GetRightBottom();
+    if(!(rightBottom.x > 0.0f && rightBottom.y < 0.0f))
+        return sheets;
+
+    const unsigned papHorizontal = 1u + static_cast<unsigned>(rightBottom.x * 10.0f) / papWidth;
+    const unsigned papVertical   = 1u + static_cast<unsigned>(-rightBottom.y * 10.0f) / papHeight;
+
+    for(unsigned x=0; x<papHorizontal; x++)
+    for(unsigned y=0; y<papVertical; y++)
+    {
+        const glm::vec2 sheetPos(x * papWidth * 0.1f, (y+1) * (papHeight * 0.1f) * -1.0f);
+        if(m_model.Intersects(
+                    SAABBox2D(glm::vec2(sheetPos.x + papWidth * 0.1f, sheetPos.y),
+                              glm::vec2(sheetPos.x, sheetPos.y + papHeight * 0.1f))
+                    ))
+            sheets.push_back(sheetPos);
+    }
+    return sheets;
+}
+
+QImage CSheetPainter::DrawImageFromSheet(const glm::vec2& pos) const
+{
+    const CSettings& sett = CSettings::GetInstance();
+
+    const int papW = sett.GetPaperWidth();
+    const int papH = sett.GetPaperHeight();
+    const int imgW = (int)(papW * sett.GetResolutionScale());
+    const int imgH = (int)(papH * sett.GetResolutionScale());
+    const qreal scale = sett.GetResolutionScale() * 10.0;
+
+    QImage img(imgW, imgH, QImage::Format_RGB32);
+    img.fill(Qt::white);
+
+    QPainter painter(&img);
+    painter.setTransform(QTransform(scale, 0.0, 0.0, -scale, -pos.x * scale, (pos.y + papH * 0.1f) * scale));
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+    //every triangle is read below, so bring them up to date group by group
+    for(const CMesh::STriGroup& grp : m_model.GetGroups())
+        grp.UpdateWorldData();
+
+    const unsigned char renFlags = sett.GetRenderFlags();
+    if(renFlags & CSettings::R_FLAPS)
+        DrawFlaps(painter);
+
+    //same as depth test: groups with lower depth are on top
+    std::vector<const CMesh::STriGroup*> groups;
+    for(const CMesh::STriGroup& grp : m_model.GetGroups())
+        groups.push_back(&grp);
+    std::stable_sort(groups.begin(), groups.end(), [](const CMesh::STriGroup* a, const CMesh::STriGroup* b)
+    {
+        return a->GetDepth() > b->GetDepth();
+    });
+
+    for(const CMesh::STriGroup* grp : groups)
+    {
+        DrawGroup(painter, *grp);
+        if(renFlags & (CSettings::R_EDGES | CSettings::R_FOLDS))
+            DrawEdges(painter, *grp);
+    }
+
+    painter.end();
+    return img;
+}
+
+void CSheetPainter::DrawFlaps(QPainter& painter) const
+{
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    for(const CMesh::SEdge &e : m_model.GetEdges())
+    {
+        if(e.IsSnapped())
+            continue;
+
+        switch(e.GetFlapPosition())
+        {
+        case CMesh::SEdge::FP_LEFT:
+            RenderFlap(painter, *m_model.GetEdgeTriangle(e, 0), e.GetTriIndex(0));
+            break;
+        case CMesh::SEdge::FP_RIGHT:
+            RenderFlap(painter, *m_model.GetEdgeTriangle(e, 1), e.GetTriIndex(1));
+            break;
+        case CMesh::SEdge::FP_BOTH:
+            RenderFlap(painter, *m_model.GetEdgeTriangle(e, 0), e.GetTriIndex(0));
+            RenderFlap(painter, *m_model.GetEdgeTriangle(e, 1), e.GetTriIndex(1));
+            break;
+        case CMesh::SEdge::FP_NONE:
+        default:
+            break;
+        }
+    }
+}
+
+void CSheetPainter::DrawGroup(QPainter& painter, const CMesh::STriGroup& grp) const
+{
+    //antialiasing would leave seams between adjacent triangles
+    painter.setRenderHint(QPainter::Antialiasing, false);
+    painter.setPen(Qt::NoPen);
+
+    const bool renTexture = CSettings::GetInstance().GetRenderFlags() & CSettings::R_TEXTR;
+    const std::vector<glm::vec2> &uvs = m_model.GetUVCoords();
+
+    for(const CMesh::STriangle2D* tri : grp.GetTriangles())
+    {
+        const CMesh::STriangle2D& tr2D = *tri;
+        const glm::uvec4 &t = m_model.GetTriangles()[tr2D.ID()];
+
+        QPolygonF polygon;
+        polygon << ToQt(tr2D[0]) << ToQt(tr2D[1]) << ToQt(tr2D[2]);
+
+        const QImage* texture = nullptr;
+        if(renTexture)
+        {
+            auto it = m_textures.find(t[3]);
+            if(it != m_textures.end() && it->second && !it->second->isNull())
+                texture = it->second.get();
+        }
+
+        if(!texture)
+        {
+            painter.setBrush(Qt::white);
+            painter.drawPolygon(polygon);
+            continue;
+        }
+
+        //map texture pixels onto triangle
+        const glm::vec2 texSize(texture->width(), texture->height());
+        const glm::vec2 t0 = uvs[t[0]] * texSize;
+        const glm::vec2 t1 = uvs[t[1]] * texSize;
+        const glm::vec2 t2 = uvs[t[2]] * texSize;
+        const glm::mat2 texMx(t1 - t0, t2 - t0);
+        const float det = texMx[0][0]*texMx[1][1] - texMx[1][0]*texMx[0][1];
+
+        if(glm::abs(det) < 1e-6f)
+        {
+            //degenerate mapping, whole triangle has the color of a single texel
+            const int x = glm::clamp((int)t0.x, 0, texture->width()-1);
+            const int y = glm::clamp((int)t0.y, 0, texture->height()-1);
+            painter.setBrush(QColor(texture->pixel(x, y)));
+            painter.drawPolygon(polygon);
+            continue;
+        }
+
+        const glm::mat2 posMx(tr2D[1] - tr2D[0], tr2D[2] - tr2D[0]);
+        const glm::mat2 texToPos = posMx * glm::inverse(texMx);
+        const glm::vec2 offset = tr2D[0] - texToPos * t0;
+
+        QBrush brush(*texture);
+        brush.setTransform(QTransform(texToPos[0][0], texToPos[0][1],
+                                      texToPos[1][0], texToPos[1][1],
+                                      offset.x, offset.y));
+        painter.setBrush(brush);
+        painter.drawPolygon(polygon);
+    }
+}
+
+void CSheetPainter::DrawEdges(QPainter& painter, const CMesh::STriGroup& grp) const
+{
+    const CSettings& sett = CSettings::GetInstance();
+    const unsigned char renFlags = sett.GetRenderFlags();
+    const float maxFlatAngle = (float)sett.GetFoldMaxFlatAngle();
+
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setBrush(Qt::NoBrush);
+
+    //same choice of edges as in CRenderer2DLegacy::DrawEdges, but only for triangles of this group
+    for(const CMesh::STriangle2D* tri : grp.GetTriangles())
+    {
+        for(int i=0; i<3; ++i)
+        {
+            const CMesh::SEdge& e = *tri->GetEdge(i);
+            const int foldType = (int)e.GetFoldType();
+            if(foldType == CMesh::SEdge::FT_FLAT && e.IsSnapped())
+                continue;
+
+            if(e.HasTwoTriangles())
+            {
+                if(e.IsSnapped() && (renFlags & CSettings::R_FOLDS))
+                {
+                    if(e.GetAngle() > maxFlatAngle && m_model.GetEdgeTriangle(e, 0) == tri)
+                        RenderEdge(painter, *tri, i, foldType);
+                } else if(!e.IsSnapped() && (renFlags & CSettings::R_EDGES)) {
+                    RenderEdge(painter, *tri, i, CMesh::SEdge::FT_FLAT);
+                }
+            } else if(renFlags & CSettings::R_EDGES) {
+                RenderEdge(painter, *tri, i, CMesh::SEdge::FT_FLAT);
+            }
+        }
+    }
+}
+
+void CSheetPainter::RenderFlap(QPainter& painter, const CMesh::STriangle2D& t, int edge) const
+{
+    const glm::vec2 &v1 = t[edge];
+    const glm::vec2 &v2 = t[(edge+1)%3];
+    const glm::vec2 vN = t.GetNormal(edge) * 0.5f;
+
+    QPolygonF polygon;
+    if(t.IsFlapSharp(edge))
+    {
+        polygon << ToQt(v1)
+                << ToQt(0.5f*v1 + 0.5f*v2 + vN)
+                << ToQt(v2)
+                << ToQt(0.5f*v1 + 0.5f*v2);
+    } else {
+        polygon << ToQt(v1)
+                << ToQt(0.9f*v1 + 0.1f*v2 + vN)
+                << ToQt(0.1f*v1 + 0.9f*v2 + vN)
+                << ToQt(v2);
+    }
+
+    QPen pen(Qt::black);
+    pen.setWidthF(0.03f * CSettings::GetInstance().GetLineWidth());
+    pen.setJoinStyle(Qt::MiterJoin);
+    painter.setPen(pen);
+    painter.setBrush(Qt::white);
+    painter.drawPolygon(polygon);
+}
+
+void CSheetPainter::RenderEdge(QPainter& painter, const CMesh::STriangle2D& t, int edge, int foldType) const
+{
+    const CSettings& sett = CSettings::GetInstance();
+    const glm::vec2 &v1 = t[edge];
+    const glm::vec2 &v2 = t[(edge+1)%3];
+
+    QPen pen(Qt::black);
+    pen.setWidthF(0.03f * sett.GetLineWidth());
+    pen.setCapStyle(Qt::FlatCap);
+    if(foldType != CMesh::SEdge::FT_FLAT)
+    {
+        qreal offset = 0.0;
+        pen.setDashPattern(GetFoldPattern(foldType, 1.0 / sett.GetStippleLoop(), pen.widthF(), offset));
+        pen.setDashOffset(offset);
+    }
+    painter.setPen(pen);
+    painter.drawLine(ToQt(v1), ToQt(v2));
+}
@@ -0,0 +1,50 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SHEETPAINTER_H
+#define SHEETPAINTER_H
+#include <QImage>
+#include <glm/vec2.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "mesh/mesh.h"
+
+class QPainter;
+
+//Software counterpart of IRenderer2D::DrawImageFromSheet, needs no display or GL context
+class CSheetPainter
+{
+public:
+    CSheetPainter(const CMesh& mdl, const std::unordered_map<unsigned, std::unique_ptr<QImage>>& textures);
+
+    //positions of sheets, that have parts on them, in the order they are exported
+    std::vector<glm::vec2>  GetOccupiedSheets() const;
+    QImage                  DrawImageFromSheet(const glm::vec2& pos) const;
+
+private:
+    void    DrawFlaps(QPainter& painter) const;
+    void    DrawGroup(QPainter& painter, const CMesh::STriGroup& grp) const;
+    void    DrawEdges(QPainter& painter, const CMesh::STriGroup& grp) const;
+    void    RenderFlap(QPainter& painter, const CMesh::STriangle2D& t, int edge) const;
+    void    RenderEdge(QPainter& painter, const CMesh::STriangle2D& t, int edge, int foldType) const;
+
+    const CMesh&                                                    m_model;
+    const std::unordered_map<unsigned, std::unique_ptr<QImage>>&    m_textures;
+};
+
+#endif // SHEETPAINTER_H
@@ -0,0 +1,366 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cassert>
+#include <glm/common.hpp>
+#include "geometric/aabbtree.h"
+
+using glm::vec2;
+using glm::min;
+using glm::max;
+
+namespace
+{
+float Perimeter(const vec2& bMin, const vec2& bMax)
+{
+    return 2.0f*(bMax.x - bMin.x + bMax.y - bMin.y);
+}
+
+bool Contains(const vec2& outerMin, const vec2& outerMax, const vec2& innerMin, const vec2& innerMax)
+{
+    return outerMin.x <= innerMin.x && outerMin.y <= innerMin.y &&
+           outerMax.x >= innerMax.x && outerMax.y >= innerMax.y;
+}
+
+} //namespace anonymous
+
+CAABBTree2D::CAABBTree2D(float margin) :
+    m_root(NullNode),
+    m_freeList(NullNode),
+    m_proxyCount(0),
+    m_margin(margin)
+{
+}
+
+int CAABBTree2D::AllocateNode()
+{
+    if(m_freeList == NullNode)
+    {
+        m_nodes.emplace_back();
+        m_nodes.back().parent = NullNode;
+        m_freeList = static_cast<int>(m_nodes.size()) - 1;
+    }
+
+    int node = m_freeList;
+    SNode& n = m_nodes[node];
+    m_freeList = n.parent;
+    n.parent = NullNode;
+    n.child1 = NullNode;
+    n.child2 = NullNode;
+    n.height = 0;
+    n.userData = nullptr;
+    return node;
+}
+
+void CAABBTree2D::FreeNode(int node)
+{
+    assert(node >= 0 && node < static_cast<int>(m_nodes.size()));
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+int CAABBTree2D::Insert(const SAABBox2D& box, void* userData)
+{
+    int proxy = AllocateNode();
+    SNode& n = m_nodes[proxy];
+    n.min = box.GetLeftBottom() - vec2(m_margin, m_margin);
+    n.max = box.GetRightTop() + vec2(m_margin, m_margin);
+    n.userData = userData;
+    InsertLeaf(proxy);
+    m_proxyCount++;
+    return proxy;
+}
+
+void CAABBTree2D::Remove(int proxy)
+{
+    assert(proxy >= 0 && proxy < static_cast<int>(m_nodes.size()) && m_nodes[proxy].IsLeaf());
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    m_proxyCount--;
+}
+
+bool CAABBTree2D::Move(int proxy, const SAABBox2D& box)
+{
+    assert(proxy >= 0 && proxy < static_cast<int>(m_nodes.size()) && m_nodes[proxy].IsLeaf());
+    const vec2 bMin = box.GetLeftBottom();
+    const vec2 bMax = box.GetRightTop();
+    if(Contains(m_nodes[proxy].min, m_nodes[proxy].max, bMin, bMax))
+        return false;
+
+    RemoveLeaf(proxy);
+    m_nodes[proxy].min = bMin - vec2(m_margin, m_margin);
+    m_nodes[proxy].max = bMax + vec2(m_margin, m_margin);
+    InsertLeaf(proxy);
+    return true;
+}
+
+void CAABBTree2D::Clear()
+{
+    m_nodes.clear();
+    m_root = NullNode;
+    m_freeList = NullNode;
+    m_proxyCount = 0;
+}
+
+void* CAABBTree2D::GetUserData(int proxy) const
+{
+    assert(proxy >= 0 && proxy < static_cast<int>(m_nodes.size()));
+    return m_nodes[proxy].userData;
+}
+
+SAABBox2D CAABBTree2D::GetFatBox(int proxy) const
+{
+    assert(proxy >= 0 && proxy < static_cast<int>(m_nodes.size()));
+    const SNode& n = m_nodes[proxy];
+    return SAABBox2D(vec2(n.max.x, n.min.y), vec2(n.min.x, n.max.y));
+}
+
+void CAABBTree2D::InsertLeaf(int leaf)
+{
+    if(m_root == NullNode)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NullNode;
+        return;
+    }
+
+    //find the best sibling by perimeter heuristic
+    const vec2 leafMin = m_nodes[leaf].min;
+    const vec2 leafMax = m_nodes[leaf].max;
+    int index = m_root;
+    while(!m_nodes[index].IsLeaf())
+    {
+        const SNode& n = m_nodes[index];
+        const float perimeter = Perimeter(n.min, n.max);
+        const float combinedPerimeter = Perimeter(min(n.min, leafMin), max(n.max, leafMax));
+
+        //cost of creating a new parent for this node and the new leaf
+        const float cost = 2.0f * combinedPerimeter;
+        //minimum cost of pushing the leaf further down the tree
+        const float inheritanceCost = 2.0f * (combinedPerimeter - perimeter);
+
+        float childCost[2];
+        const int children[2] = { n.child1, n.child2 };
+        for(int c=0; c<2; ++c)
+        {
+            const SNode& child = m_nodes[children[c]];
+            const float newPerimeter = Perimeter(min(child.min, leafMin), max(child.max, leafMax));
+            if(child.IsLeaf())
+                childCost[c] = newPerimeter + inheritanceCost;
+            else
+                childCost[c] = newPerimeter - Perimeter(child.min, child.max) + inheritanceCost;
+        }
+
+        if(cost < childCost[0] && cost < childCost[1])
+            break;
+
+        index = childCost[0] < childCost[1] ? n.child1 : n.child2;
+    }
+
+    const int sibling = index;
+    const int oldParent = m_nodes[sibling].parent;
+    const int newParent = AllocateNode();
+    SNode& p = m_nodes[newParent];
+    p.parent = oldParent;
+    p.min = min(m_nodes[sibling].min, leafMin);
+    p.max = max(m_nodes[sibling].max, leafMax);
+    p.height = m_nodes[sibling].height + 1;
+    p.child1 = sibling;
+    p.child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if(oldParent != NullNode)
+    {
+        if(m_nodes[oldParent].child1 == sibling)
+            m_nodes[oldParent].child1 = newParent;
+        else
+            m_nodes[oldParent].child2 = newParent;
+    }
+    else
+    {
+        m_root = newParent;
+    }
+
+    Refit(m_nodes[leaf].parent);
+}
+
+void CAABBTree2D::RemoveLeaf(int leaf)
+{
+    if(leaf == m_root)
+    {
+        m_root = NullNode;
+        return;
+    }
+
+    const int parent = m_nodes[leaf].parent;
+    const int grandParent = m_nodes[parent].parent;
+    const int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if(grandParent != NullNode)
+    {
+        if(m_nodes[grandParent].child1 == parent)
+            m_nodes[grandParent].child1 = sibling;
+        else
+            m_nodes[grandParent].child2 = sibling;
+        m_nodes[sibling].parent = grandParent;
+        FreeNode(parent);
+        Refit(grandParent);
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = NullNode;
+        FreeNode(parent);
+    }
+}
+
+void CAABBTree2D::Refit(int node)
+{
+    while(node != NullNode)
+    {
+        node = Balance(node);
+
+        SNode& n = m_nodes[node];
+        const SNode& c1 = m_nodes[n.child1];
+        const SNode& c2 = m_nodes[n.child2];
+        n.height = 1 + std::max(c1.height, c2.height);
+        n.min = min(c1.min, c2.min);
+        n.max = max(c1.max, c2.max);
+
+        node = n.parent;
+    }
+}
+
+//performs left or right rotation if node A is imbalanced, returns new subtree root
+int CAABBTree2D::Balance(int iA)
+{
+    SNode& A = m_nodes[iA];
+    if(A.IsLeaf() || A.height < 2)
+        return iA;
+
+    const int iB = A.child1;
+    const int iC = A.child2;
+    SNode& B = m_nodes[iB];
+    SNode& C = m_nodes[iC];
+
+    const int balance = C.height - B.height;
+    if(balance > 1 || balance < -1)
+    {
+        //rotate the taller child up
+        const int iUp = balance > 1 ? iC : iB;
+        const int iStay = balance > 1 ? iB : iC;
+        SNode& up = m_nodes[iUp];
+        const int iF = up.child1;
+        const int iG = up.child2;
+        SNode& F = m_nodes[iF];
+        SNode& G = m_nodes[iG];
+
+        up.child1 = iA;
+        up.parent = A.parent;
+        A.parent = iUp;
+
+        if(up.parent != NullNode)
+        {
+            if(m_nodes[up.parent].child1 == iA)
+                m_nodes[up.parent].child1 = iUp;
+            else
+                m_nodes[up.parent].child2 = iUp;
+        }
+        else
+        {
+            m_root = iUp;
+        }
+
+        //the taller grandchild stays with 'up', the other one goes to A
+        const int iTall = F.height > G.height ? iF : iG;
+        const int iShort = F.height > G.height ? iG : iF;
+        up.child2 = iTall;
+        if(balance > 1)
+            A.child2 = iShort;
+        else
+            A.child1 = iShort;
+        m_nodes[iShort].parent = iA;
+
+        const SNode& stay = m_nodes[iStay];
+        const SNode& shortNode = m_nodes[iShort];
+        const SNode& tallNode = m_nodes[iTall];
+        A.min = min(stay.min, shortNode.min);
+        A.max = max(stay.max, shortNode.max);
+        A.height = 1 + std::max(stay.height, shortNode.height);
+        up.min = min(A.min, tallNode.min);
+        up.max = max(A.max, tallNode.max);
+        up.height = 1 + std::max(A.height, tallNode.height);
+
+        return iUp;
+    }
+
+    return iA;
+}
+
+template<typename TOverlap>
+void CAABBTree2D::QueryImpl(TOverlap overlaps, const std::function<bool(int)>& callback) const
+{
+    if(m_root == NullNode)
+        return;
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+    while(!stack.empty())
+    {
+        const int index = stack.back();
+        stack.pop_back();
+
+        const SNode& n = m_nodes[index];
+        if(!overlaps(n.min, n.max))
+            continue;
+
+        if(n.IsLeaf())
+        {
+            if(!callback(index))
+                return;
+        }
+        else
+        {
+            stack.push_back(n.child1);
+            stack.push_back(n.child2);
+        }
+    }
+}
+
+void CAABBTree2D::Query(const SAABBox2D& box, const std::function<bool(int)>& callback) const
+{
+    const vec2 bMin = box.GetLeftBottom();
+    const vec2 bMax = box.GetRightTop();
+    QueryImpl([&bMin, &bMax](const vec2& nMin, const vec2& nMax)
+    {
+        return nMin.x <= bMax.x && nMax.x >= bMin.x &&
+               nMin.y <= bMax.y && nMax.y >= bMin.y;
+    }, callback);
+}
+
+void CAABBTree2D::Query(const vec2& point, const std::function<bool(int)>& callback) const
+{
+    QueryImpl([&point](const vec2& nMin, const vec2& nMax)
+    {
+        return nMin.x <= point.x && nMax.x >= point.x &&
+               nMin.y <= point.y && nMax.y >= point.y;
+    }, callback);
+}
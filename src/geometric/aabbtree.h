@@ -0,0 +1,83 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef AABB_TREE_H
+#define AABB_TREE_H
+#include <vector>
+#include <functional>
+#include <glm/vec2.hpp>
+#include "geometric/aabbox.h"
+
+//Dynamic bounding volume hierarchy of 2D boxes.
+//Leaves (proxies) can be inserted, moved and removed one at a time,
+//the tree is kept balanced with AVL-like rotations.
+class CAABBTree2D
+{
+public:
+    static const int NullNode = -1;
+
+    //margin - boxes are enlarged by it on insertion,
+    //so that small moves do not require tree update
+    explicit CAABBTree2D(float margin = 0.0f);
+
+    int                  Insert(const SAABBox2D& box, void* userData);
+    void                 Remove(int proxy);
+    //returns true if proxy has been reinserted
+    bool                 Move(int proxy, const SAABBox2D& box);
+    void                 Clear();
+
+    bool                 Empty() const { return m_root == NullNode; }
+    std::size_t          GetProxyCount() const { return m_proxyCount; }
+    void*                GetUserData(int proxy) const;
+    SAABBox2D            GetFatBox(int proxy) const;
+
+    //callback returns false to stop the query
+    void                 Query(const SAABBox2D& box, const std::function<bool(int)>& callback) const;
+    void                 Query(const glm::vec2& point, const std::function<bool(int)>& callback) const;
+
+private:
+    struct SNode
+    {
+        glm::vec2 min;
+        glm::vec2 max;
+        void*     userData;
+        int       parent; //next free node, if node is not used
+        int       child1;
+        int       child2;
+        int       height; //-1 for free nodes, 0 for leaves
+
+        bool IsLeaf() const { return child1 == NullNode; }
+    };
+
+    int                  AllocateNode();
+    void                 FreeNode(int node);
+    void                 InsertLeaf(int leaf);
+    void                 RemoveLeaf(int leaf);
+    int                  Balance(int node);
+    void                 Refit(int node);
+
+    template<typename TOverlap>
+    void                 QueryImpl(TOverlap overlaps, const std::function<bool(int)>& callback) const;
+
+    std::vector<SNode>   m_nodes;
+    int                  m_root;
+    int                  m_freeList;
+    std::size_t          m_proxyCount;
+    float                m_margin;
+};
+
+#endif // AABB_TREE_H
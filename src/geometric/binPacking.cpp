@@ -19,10 +19,297 @@
 #include <cmath>
 #include <list>
 #include <cstddef>
+#include <numeric>
 #include "geometric/binPacking.h"
 
 using glm::vec2;
 
+namespace
+{
+struct SRect
+{
+    float x;
+    float y;
+    float width;
+    float height;
+
+    bool Contains(const SRect& o) const
+    {
+        return o.x >= x && o.y >= y && o.x + o.width <= x + width && o.y + o.height <= y + height;
+    }
+    bool Intersects(const SRect& o) const
+    {
+        return o.x < x + width && x < o.x + o.width && o.y < y + height && y < o.y + o.height;
+    }
+};
+
+//big boxes first, they are the hardest to place
+std::vector<std::size_t> GetPackingOrder(const std::vector<SAABBox2D*>& boxes)
+{
+    std::vector<std::size_t> order(boxes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&boxes](std::size_t i, std::size_t j)
+    {
+        const float sideI = std::max(boxes[i]->width, boxes[i]->height);
+        const float sideJ = std::max(boxes[j]->width, boxes[j]->height);
+        if(std::abs(sideI - sideJ) > 0.001f)
+            return sideI > sideJ;
+        return boxes[i]->width * boxes[i]->height > boxes[j]->width * boxes[j]->height;
+    });
+    return order;
+}
+
+class CMaxRectsBin
+{
+public:
+    CMaxRectsBin(float width, float height)
+    {
+        m_free.push_back(SRect{0.0f, 0.0f, width, height});
+    }
+
+    //best short side fit; false if box does not fit
+    bool FindPosition(float width, float height, bool allowRotation, SRect& pos, bool& rotated, float& shortSide, float& longSide) const
+    {
+        bool found = false;
+        for(const SRect& fr : m_free)
+        {
+            for(int r=0; r<(allowRotation ? 2 : 1); ++r)
+            {
+                const float w = (r == 0 ? width : height);
+                const float h = (r == 0 ? height : width);
+                if(w > fr.width || h > fr.height)
+                    continue;
+
+                const float leftoverH = fr.width - w;
+                const float leftoverV = fr.height - h;
+                const float shortFit = std::min(leftoverH, leftoverV);
+                const float longFit = std::max(leftoverH, leftoverV);
+                if(!found || shortFit < shortSide || (shortFit == shortSide && longFit < longSide))
+                {
+                    found = true;
+                    pos = SRect{fr.x, fr.y, w, h};
+                    rotated = r != 0;
+                    shortSide = shortFit;
+                    longSide = longFit;
+                }
+            }
+        }
+        return found;
+    }
+
+    void Place(const SRect& placed)
+    {
+        std::vector<SRect> newFree;
+        for(std::size_t i=0; i<m_free.size();)
+        {
+            const SRect fr = m_free[i];
+            if(!fr.Intersects(placed))
+            {
+                ++i;
+                continue;
+            }
+
+            if(placed.x > fr.x)
+                newFree.push_back(SRect{fr.x, fr.y, placed.x - fr.x, fr.height});
+            if(placed.x + placed.width < fr.x + fr.width)
+                newFree.push_back(SRect{placed.x + placed.width, fr.y, fr.x + fr.width - placed.x - placed.width, fr.height});
+            if(placed.y > fr.y)
+                newFree.push_back(SRect{fr.x, fr.y, fr.width, placed.y - fr.y});
+            if(placed.y + placed.height < fr.y + fr.height)
+                newFree.push_back(SRect{fr.x, placed.y + placed.height, fr.width, fr.y + fr.height - placed.y - placed.height});
+
+            m_free[i] = m_free.back();
+            m_free.pop_back();
+        }
+
+        //only maximal rectangles are kept
+        for(const SRect& rect : newFree)
+        {
+            bool contained = false;
+            for(const SRect& fr : m_free)
+            {
+                if(fr.Contains(rect))
+                {
+                    contained = true;
+                    break;
+                }
+            }
+            if(contained)
+                continue;
+            m_free.erase(std::remove_if(m_free.begin(), m_free.end(), [&rect](const SRect& fr) { return rect.Contains(fr); }), m_free.end());
+            m_free.push_back(rect);
+        }
+    }
+
+private:
+    std::vector<SRect> m_free;
+};
+
+class CSkylineBin
+{
+public:
+    CSkylineBin(float width, float height) :
+        m_width(width),
+        m_height(height)
+    {
+        m_skyline.push_back(SSegment{0.0f, 0.0f, width});
+    }
+
+    //lowest top edge, then leftmost; false if box does not fit
+    bool FindPosition(float width, float height, bool allowRotation, SRect& pos, bool& rotated, float& top, float& left) const
+    {
+        bool found = false;
+        for(std::size_t i=0; i<m_skyline.size(); ++i)
+        {
+            for(int r=0; r<(allowRotation ? 2 : 1); ++r)
+            {
+                const float w = (r == 0 ? width : height);
+                const float h = (r == 0 ? height : width);
+                float y = 0.0f;
+                if(!Fits(i, w, h, y))
+                    continue;
+
+                const float x = m_skyline[i].x;
+                if(!found || y + h < top || (y + h == top && x < left))
+                {
+                    found = true;
+                    pos = SRect{x, y, w, h};
+                    rotated = r != 0;
+                    top = y + h;
+                    left = x;
+                }
+            }
+        }
+        return found;
+    }
+
+    void Place(const SRect& placed)
+    {
+        std::size_t index = 0;
+        while(m_skyline[index].x + m_skyline[index].width <= placed.x)
+            ++index;
+        m_skyline.insert(m_skyline.begin() + index, SSegment{placed.x, placed.y + placed.height, placed.width});
+
+        //cut segments, that are covered by the new one
+        const float right = placed.x + placed.width;
+        for(std::size_t i=index+1; i<m_skyline.size();)
+        {
+            SSegment& seg = m_skyline[i];
+            if(seg.x >= right)
+                break;
+            const float segRight = seg.x + seg.width;
+            if(segRight <= right)
+            {
+                m_skyline.erase(m_skyline.begin() + i);
+                continue;
+            }
+            seg.width = segRight - right;
+            seg.x = right;
+            break;
+        }
+
+        for(std::size_t i=0; i+1<m_skyline.size();)
+        {
+            if(m_skyline[i].y == m_skyline[i+1].y)
+            {
+                m_skyline[i].width += m_skyline[i+1].width;
+                m_skyline.erase(m_skyline.begin() + i + 1);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+private:
+    struct SSegment
+    {
+        float x;
+        float y;
+        float width;
+    };
+
+    bool Fits(std::size_t index, float width, float height, float& y) const
+    {
+        const float x = m_skyline[index].x;
+        if(x + width > m_width)
+            return false;
+
+        y = 0.0f;
+        float widthLeft = width;
+        for(std::size_t i=index; widthLeft > 0.0f; ++i)
+        {
+            if(i == m_skyline.size())
+                return false;
+            y = std::max(y, m_skyline[i].y);
+            if(y + height > m_height)
+                return false;
+            widthLeft -= m_skyline[i].width;
+        }
+        return true;
+    }
+
+    std::vector<SSegment> m_skyline;
+    float                 m_width;
+    float                 m_height;
+};
+
+//places every box into the best of open bins, opening new bin when box fits nowhere
+template<typename TBin>
+std::vector<BinPacking::SPlacement> PackIntoBins(const std::vector<SAABBox2D*>& boxes, float binWidth, float binHeight, bool allowRotation)
+{
+    std::vector<BinPacking::SPlacement> placements(boxes.size());
+    std::vector<TBin> bins;
+
+    for(std::size_t index : GetPackingOrder(boxes))
+    {
+        SAABBox2D& box = *boxes[index];
+
+        std::size_t bestBin = BinPacking::notPacked;
+        SRect bestPos;
+        bool bestRotated = false;
+        float bestScore1 = 0.0f;
+        float bestScore2 = 0.0f;
+        for(std::size_t b=0; b<bins.size(); ++b)
+        {
+            SRect pos;
+            bool rotated = false;
+            float score1 = 0.0f;
+            float score2 = 0.0f;
+            if(!bins[b].FindPosition(box.width, box.height, allowRotation, pos, rotated, score1, score2))
+                continue;
+            if(bestBin == BinPacking::notPacked || score1 < bestScore1 || (score1 == bestScore1 && score2 < bestScore2))
+            {
+                bestBin = b;
+                bestPos = pos;
+                bestRotated = rotated;
+                bestScore1 = score1;
+                bestScore2 = score2;
+            }
+        }
+
+        if(bestBin == BinPacking::notPacked)
+        {
+            TBin bin(binWidth, binHeight);
+            float score1 = 0.0f;
+            float score2 = 0.0f;
+            if(!bin.FindPosition(box.width, box.height, allowRotation, bestPos, bestRotated, score1, score2))
+                continue;
+            bins.push_back(bin);
+            bestBin = bins.size() - 1;
+        }
+
+        bins[bestBin].Place(bestPos);
+        placements[index].bin = bestBin;
+        placements[index].rotated = bestRotated;
+        if(bestRotated)
+            std::swap(box.width, box.height);
+        box.position = vec2(bestPos.x + box.width * 0.5f, bestPos.y + box.height * 0.5f);
+    }
+
+    return placements;
+}
+}
+
 namespace BinPacking
 {
 std::vector<AABBoxPtr> PackFCNR(std::vector<AABBoxPtr>& bboxes, float binWidth, float binHeight)
@@ -131,4 +418,53 @@ std::vector<AABBoxPtr> PackFCNR(std::vector<AABBoxPtr>& bboxes, float binWidth,
 
     return packedBoxes;
 }
+
+namespace
+{
+struct SIndexedBox : SAABBox2D
+{
+    std::size_t index;
+};
+}
+
+std::vector<SPlacement> CFCNRPacker::Pack(const std::vector<SAABBox2D*>& boxes, float binWidth, float binHeight) const
+{
+    std::vector<SPlacement> placements(boxes.size());
+
+    std::vector<AABBoxPtr> toPack;
+    toPack.reserve(boxes.size());
+    for(std::size_t i=0; i<boxes.size(); ++i)
+    {
+        SIndexedBox* box = new SIndexedBox();
+        static_cast<SAABBox2D&>(*box) = *boxes[i];
+        box->index = i;
+        toPack.emplace_back(box);
+    }
+
+    //every call fills one bin, until nothing else can be packed
+    for(std::size_t bin=0; !toPack.empty(); ++bin)
+    {
+        const std::vector<AABBoxPtr> packed = PackFCNR(toPack, binWidth, binHeight);
+        if(packed.empty())
+            break;
+        for(const AABBoxPtr& boxPtr : packed)
+        {
+            const SIndexedBox& box = static_cast<const SIndexedBox&>(*boxPtr);
+            boxes[box.index]->position = box.position;
+            placements[box.index].bin = bin;
+        }
+    }
+
+    return placements;
+}
+
+std::vector<SPlacement> CMaxRectsPacker::Pack(const std::vector<SAABBox2D*>& boxes, float binWidth, float binHeight) const
+{
+    return PackIntoBins<CMaxRectsBin>(boxes, binWidth, binHeight, m_allowRotation);
+}
+
+std::vector<SPlacement> CSkylinePacker::Pack(const std::vector<SAABBox2D*>& boxes, float binWidth, float binHeight) const
+{
+    return PackIntoBins<CSkylineBin>(boxes, binWidth, binHeight, m_allowRotation);
+}
 } //namespace BinPacking
@@ -19,6 +19,8 @@
 #define BIN_PACKING_H
 #include <vector>
 #include <memory>
+#include <limits>
+#include <cstddef>
 #include "geometric/aabbox.h"
 
 namespace BinPacking
@@ -26,6 +28,52 @@ namespace BinPacking
 using AABBoxPtr = std::unique_ptr<SAABBox2D>;
 
 std::vector<AABBoxPtr> PackFCNR(std::vector<AABBoxPtr>& bboxes, float binWidth, float binHeight);
+
+const std::size_t notPacked = std::numeric_limits<std::size_t>::max();
+
+struct SPlacement
+{
+    std::size_t bin = notPacked;
+    bool        rotated = false; //box is turned by 90 degrees, its width and height are swapped
+};
+
+//packs boxes into as many bins of the same size as needed; box positions (centers relative
+//to left bottom corner of the bin) and sizes of rotated boxes are written into boxes
+class IBinPacker
+{
+public:
+    virtual ~IBinPacker() = default;
+    virtual std::vector<SPlacement> Pack(const std::vector<SAABBox2D*>& boxes, float binWidth, float binHeight) const = 0;
+};
+
+//floor-ceiling shelves, filled bin after bin; never rotates boxes
+class CFCNRPacker : public IBinPacker
+{
+public:
+    std::vector<SPlacement> Pack(const std::vector<SAABBox2D*>& boxes, float binWidth, float binHeight) const override;
+};
+
+//maximal free rectangles, best short side fit among all open bins
+class CMaxRectsPacker : public IBinPacker
+{
+public:
+    explicit CMaxRectsPacker(bool allowRotation = true) : m_allowRotation(allowRotation) {}
+    std::vector<SPlacement> Pack(const std::vector<SAABBox2D*>& boxes, float binWidth, float binHeight) const override;
+
+private:
+    bool m_allowRotation;
+};
+
+//bottom-left placement on a skyline of every open bin
+class CSkylinePacker : public IBinPacker
+{
+public:
+    explicit CSkylinePacker(bool allowRotation = true) : m_allowRotation(allowRotation) {}
+    std::vector<SPlacement> Pack(const std::vector<SAABBox2D*>& boxes, float binWidth, float binHeight) const override;
+
+private:
+    bool m_allowRotation;
+};
 }
 
 #endif
@@ -0,0 +1,491 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <unordered_map>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <functional>
+#include <glm/geometric.hpp>
+#include "geometric/nesting.h"
+#include "geometric/compgeom.h"
+#include "geometric/obbox.h"
+#include "threading/parallelfor.h"
+
+using glm::vec2;
+using glm::cross;
+using Nesting::ConvexPolygon;
+
+namespace
+{
+//points closer than this to the border of a no-fit polygon are considered to be outside of it
+const float touchTolerance = 1e-4f;
+const float keyScale = 1000.0f;
+
+struct SRange
+{
+    vec2 min;
+    vec2 max;
+};
+
+SRange GetRange(const ConvexPolygon& poly)
+{
+    SRange range{vec2(std::numeric_limits<float>::max()), vec2(std::numeric_limits<float>::lowest())};
+    for(const vec2& v : poly)
+    {
+        range.min = glm::min(range.min, v);
+        range.max = glm::max(range.max, v);
+    }
+    return range;
+}
+
+float GetArea(const ConvexPolygon& poly)
+{
+    float area = 0.0f;
+    for(std::size_t i=1; i+1<poly.size(); ++i)
+        area += cross(poly[i] - poly[0], poly[i+1] - poly[0]);
+    return area * 0.5f;
+}
+
+bool IsConvex(const ConvexPolygon& poly)
+{
+    const std::size_t n = poly.size();
+    for(std::size_t i=0; i<n; ++i)
+        if(cross(poly[(i+1)%n] - poly[i], poly[(i+2)%n] - poly[(i+1)%n]) < -1e-6f)
+            return false;
+    return true;
+}
+
+//both polygons are convex and counter-clockwise; O(n + m) merge of edges sorted by angle
+ConvexPolygon MinkowskiSum(const ConvexPolygon& p, const ConvexPolygon& q)
+{
+    auto lowest = [](const ConvexPolygon& poly)
+    {
+        std::size_t index = 0;
+        for(std::size_t i=1; i<poly.size(); ++i)
+            if(poly[i].y < poly[index].y || (poly[i].y == poly[index].y && poly[i].x < poly[index].x))
+                index = i;
+        return index;
+    };
+
+    const std::size_t n = p.size();
+    const std::size_t m = q.size();
+    const std::size_t pStart = lowest(p);
+    const std::size_t qStart = lowest(q);
+    auto P = [&](std::size_t i) -> const vec2& { return p[(pStart + i) % n]; };
+    auto Q = [&](std::size_t j) -> const vec2& { return q[(qStart + j) % m]; };
+
+    ConvexPolygon result;
+    result.reserve(n + m);
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while(i < n || j < m)
+    {
+        const vec2 sum = P(i) + Q(j);
+        if(result.empty() || sum != result.back())
+            result.push_back(sum);
+
+        if(i == n)
+        {
+            ++j;
+        } else if(j == m) {
+            ++i;
+        } else {
+            const float c = cross(P(i+1) - P(i), Q(j+1) - Q(j));
+            if(c >= 0.0f)
+                ++i;
+            if(c <= 0.0f)
+                ++j;
+        }
+    }
+    if(result.size() > 1 && result.back() == result.front())
+        result.pop_back();
+    return result;
+}
+
+bool StrictlyInside(const ConvexPolygon& poly, const vec2& point)
+{
+    const std::size_t n = poly.size();
+    for(std::size_t i=0; i<n; ++i)
+    {
+        const vec2 edge = poly[(i+1)%n] - poly[i];
+        const float len = glm::length(edge);
+        if(len == 0.0f)
+            continue;
+        if(cross(edge, point - poly[i]) <= touchTolerance * len)
+            return false;
+    }
+    return n >= 3;
+}
+
+using PointKey = std::uint64_t;
+using EdgeKey = std::pair<PointKey, PointKey>;
+
+PointKey GetPointKey(const vec2& v)
+{
+    const std::uint32_t x = static_cast<std::uint32_t>(static_cast<std::int32_t>(std::lround(v.x * keyScale)));
+    const std::uint32_t y = static_cast<std::uint32_t>(static_cast<std::int32_t>(std::lround(v.y * keyScale)));
+    return (static_cast<PointKey>(x) << 32) | y;
+}
+
+struct SEdgeKeyHash
+{
+    std::size_t operator()(const EdgeKey& key) const
+    {
+        return std::hash<PointKey>()(key.first * 31u + key.second);
+    }
+};
+
+//p has edge a->b, q has edge b->a; result is p and q without that edge, if it is convex
+bool TryMerge(const ConvexPolygon& p, const ConvexPolygon& q, PointKey a, PointKey b, ConvexPolygon& merged)
+{
+    const std::size_t n = p.size();
+    const std::size_t m = q.size();
+    std::size_t i = 0;
+    while(i < n && !(GetPointKey(p[i]) == a && GetPointKey(p[(i+1)%n]) == b))
+        ++i;
+    std::size_t j = 0;
+    while(j < m && !(GetPointKey(q[j]) == b && GetPointKey(q[(j+1)%m]) == a))
+        ++j;
+    if(i == n || j == m)
+        return false;
+
+    //from b around p to a, then from a around q, not including b again
+    merged.clear();
+    merged.reserve(n + m - 2);
+    for(std::size_t k=0; k<n; ++k)
+        merged.push_back(p[(i + 1 + k) % n]);
+    for(std::size_t k=2; k<m; ++k)
+        merged.push_back(q[(j + k) % m]);
+    return IsConvex(merged);
+}
+
+struct SOrientation
+{
+    std::vector<ConvexPolygon> pieces;    //inflated by gap, left bottom corner at (0, 0)
+    std::vector<ConvexPolygon> negPieces; //pieces reflected through origin
+    std::vector<SRange>        ranges;
+    vec2                       shift;     //from part's coordinates to the ones of pieces
+    vec2                       size;
+};
+
+struct SPreparedPart
+{
+    std::vector<SOrientation> orientations;
+    float                     area = 0.0f;
+};
+
+struct SBin
+{
+    std::vector<ConvexPolygon> pieces;
+    std::vector<SRange>        ranges;
+    float                      freeArea;
+};
+
+SPreparedPart PreparePart(const Nesting::SPart& part, float gap)
+{
+    const ConvexPolygon square = {vec2(-gap, -gap), vec2(gap, -gap), vec2(gap, gap), vec2(-gap, gap)};
+
+    SPreparedPart prepared;
+    for(const auto& pieces : part.orientations)
+    {
+        prepared.orientations.emplace_back();
+        SOrientation& orientation = prepared.orientations.back();
+
+        float area = 0.0f;
+        SRange total{vec2(std::numeric_limits<float>::max()), vec2(std::numeric_limits<float>::lowest())};
+        for(const ConvexPolygon& piece : pieces)
+        {
+            area += GetArea(piece);
+            orientation.pieces.push_back(gap > 0.0f ? MinkowskiSum(piece, square) : piece);
+            const SRange range = GetRange(orientation.pieces.back());
+            total.min = glm::min(total.min, range.min);
+            total.max = glm::max(total.max, range.max);
+        }
+        if(prepared.orientations.size() == 1)
+            prepared.area = area;
+        if(pieces.empty())
+            continue;
+
+        orientation.shift = -total.min;
+        orientation.size = total.max - total.min;
+        for(ConvexPolygon& piece : orientation.pieces)
+        {
+            ConvexPolygon negPiece;
+            negPiece.reserve(piece.size());
+            for(vec2& v : piece)
+            {
+                v += orientation.shift;
+                negPiece.push_back(-v);
+            }
+            orientation.negPieces.push_back(std::move(negPiece));
+            orientation.ranges.push_back(GetRange(piece));
+        }
+    }
+    return prepared;
+}
+
+//lowest, then leftmost position of orientation's corner in the bin, where it overlaps nothing
+bool FindPosition(const SBin& bin, const SOrientation& orientation, float binWidth, float binHeight, vec2& position)
+{
+    if(orientation.pieces.empty())
+        return false;
+    const float maxX = binWidth - orientation.size.x;
+    const float maxY = binHeight - orientation.size.y;
+    if(maxX < 0.0f || maxY < 0.0f)
+        return false;
+
+    //no-fit polygons of every pair of pieces, that can touch inner-fit rectangle [0, maxX] x [0, maxY]
+    std::vector<ConvexPolygon> nfps;
+    std::vector<SRange> nfpRanges;
+    for(std::size_t a=0; a<bin.pieces.size(); ++a)
+    {
+        const SRange& rangeA = bin.ranges[a];
+        for(std::size_t b=0; b<orientation.pieces.size(); ++b)
+        {
+            const SRange& rangeB = orientation.ranges[b];
+            const SRange range{rangeA.min - rangeB.max, rangeA.max - rangeB.min};
+            if(range.max.x <= 0.0f || range.max.y <= 0.0f || range.min.x >= maxX || range.min.y >= maxY)
+                continue;
+            nfps.push_back(MinkowskiSum(bin.pieces[a], orientation.negPieces[b]));
+            nfpRanges.push_back(range);
+        }
+    }
+
+    //candidates are corners of the inner-fit rectangle and vertices of no-fit polygons, also dropped to the borders
+    std::vector<vec2> candidates = {vec2(0.0f, 0.0f), vec2(maxX, 0.0f), vec2(0.0f, maxY), vec2(maxX, maxY)};
+    for(const ConvexPolygon& nfp : nfps)
+    {
+        for(const vec2& v : nfp)
+        {
+            if(v.x < -touchTolerance || v.y < -touchTolerance || v.x > maxX + touchTolerance || v.y > maxY + touchTolerance)
+                continue;
+            const vec2 clamped(glm::clamp(v.x, 0.0f, maxX), glm::clamp(v.y, 0.0f, maxY));
+            candidates.push_back(clamped);
+            candidates.push_back(vec2(clamped.x, 0.0f));
+            candidates.push_back(vec2(0.0f, clamped.y));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const vec2& v1, const vec2& v2)
+    {
+        return v1.y < v2.y || (v1.y == v2.y && v1.x < v2.x);
+    });
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    //uniform grid over inner-fit rectangle, so every candidate is tested only against nearby polygons
+    const int gridSize = std::max(1, std::min(64, static_cast<int>(std::sqrt(static_cast<float>(nfps.size())))));
+    const vec2 cellSize(std::max(maxX, touchTolerance) / gridSize, std::max(maxY, touchTolerance) / gridSize);
+    auto toCell = [gridSize](float coord, float cell)
+    {
+        return std::max(0, std::min(gridSize - 1, static_cast<int>(coord / cell)));
+    };
+    std::vector<std::vector<std::size_t>> cells(static_cast<std::size_t>(gridSize * gridSize));
+    for(std::size_t i=0; i<nfps.size(); ++i)
+    {
+        const SRange& range = nfpRanges[i];
+        for(int y=toCell(range.min.y, cellSize.y); y<=toCell(range.max.y, cellSize.y); ++y)
+            for(int x=toCell(range.min.x, cellSize.x); x<=toCell(range.max.x, cellSize.x); ++x)
+                cells[static_cast<std::size_t>(y * gridSize + x)].push_back(i);
+    }
+
+    for(const vec2& candidate : candidates)
+    {
+        const auto& cell = cells[static_cast<std::size_t>(toCell(candidate.y, cellSize.y) * gridSize + toCell(candidate.x, cellSize.x))];
+        const bool overlaps = std::any_of(cell.begin(), cell.end(), [&](std::size_t i)
+        {
+            const SRange& range = nfpRanges[i];
+            return candidate.x > range.min.x && candidate.x < range.max.x &&
+                   candidate.y > range.min.y && candidate.y < range.max.y &&
+                   StrictlyInside(nfps[i], candidate);
+        });
+        if(!overlaps)
+        {
+            position = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+} //namespace anonymous
+
+namespace Nesting
+{
+std::vector<ConvexPolygon> GetConvexPieces(const std::vector<vec2>& triangles, std::size_t maxPieces)
+{
+    const std::size_t triCount = triangles.size() / 3;
+    std::vector<ConvexPolygon> pieces(triCount);
+    std::unordered_map<EdgeKey, std::size_t, SEdgeKeyHash> edges;
+    for(std::size_t t=0; t<triCount; ++t)
+    {
+        vec2 a = triangles[t*3];
+        vec2 b = triangles[t*3 + 1];
+        vec2 c = triangles[t*3 + 2];
+        const float area = cross(b - a, c - a);
+        if(std::abs(area) < 1e-8f)
+            continue;
+        if(area < 0.0f)
+            std::swap(b, c);
+        pieces[t] = {a, b, c};
+        for(int e=0; e<3; ++e)
+            edges[EdgeKey(GetPointKey(pieces[t][e]), GetPointKey(pieces[t][(e+1)%3]))] = t;
+    }
+
+    //shared edges are removed longest first, while pieces stay convex
+    struct SDiagonal
+    {
+        std::size_t tri1;
+        std::size_t tri2;
+        PointKey    a;
+        PointKey    b;
+        float       length2;
+    };
+    std::vector<SDiagonal> diagonals;
+    for(std::size_t t=0; t<triCount; ++t)
+    {
+        const ConvexPolygon& tri = pieces[t];
+        for(std::size_t e=0; e<tri.size(); ++e)
+        {
+            const PointKey a = GetPointKey(tri[e]);
+            const PointKey b = GetPointKey(tri[(e+1)%3]);
+            const auto it = edges.find(EdgeKey(b, a));
+            if(it == edges.end() || it->second <= t)
+                continue;
+            const vec2 edge = tri[(e+1)%3] - tri[e];
+            diagonals.push_back(SDiagonal{t, it->second, a, b, glm::dot(edge, edge)});
+        }
+    }
+    std::sort(diagonals.begin(), diagonals.end(), [](const SDiagonal& d1, const SDiagonal& d2)
+    {
+        return d1.length2 > d2.length2;
+    });
+
+    std::vector<std::size_t> parent(triCount);
+    std::iota(parent.begin(), parent.end(), 0);
+    std::function<std::size_t(std::size_t)> find = [&parent, &find](std::size_t i)
+    {
+        return parent[i] == i ? i : (parent[i] = find(parent[i]));
+    };
+
+    ConvexPolygon merged;
+    for(const SDiagonal& diagonal : diagonals)
+    {
+        const std::size_t root1 = find(diagonal.tri1);
+        const std::size_t root2 = find(diagonal.tri2);
+        if(root1 == root2 || !TryMerge(pieces[root1], pieces[root2], diagonal.a, diagonal.b, merged))
+            continue;
+        pieces[root1].swap(merged);
+        pieces[root2].clear();
+        parent[root2] = root1;
+    }
+
+    pieces.erase(std::remove_if(pieces.begin(), pieces.end(), [](const ConvexPolygon& p) { return p.empty(); }), pieces.end());
+    if(pieces.empty() || pieces.size() > maxPieces)
+        return {GetConvexHull(triangles)};
+    return pieces;
+}
+
+std::vector<SPlacement> Nest(const std::vector<SPart>& parts, float binWidth, float binHeight, float gap)
+{
+    std::vector<SPreparedPart> prepared(parts.size());
+    ParallelFor(parts.size(), 4, [&parts, &prepared, gap](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i=begin; i<end; ++i)
+            prepared[i] = PreparePart(parts[i], gap);
+    });
+
+    std::vector<std::size_t> order(parts.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&prepared](std::size_t i, std::size_t j)
+    {
+        return prepared[i].area > prepared[j].area;
+    });
+
+    std::vector<SPlacement> placements(parts.size());
+    std::vector<SBin> bins;
+    for(std::size_t index : order)
+    {
+        const SPreparedPart& part = prepared[index];
+        const std::size_t orientCount = part.orientations.size();
+        if(orientCount == 0)
+            continue;
+
+        //every orientation in every bin (and in a new one) is tried in parallel, first bin wins
+        bins.push_back(SBin{{}, {}, binWidth * binHeight});
+        struct SCandidate
+        {
+            bool found = false;
+            vec2 position;
+        };
+        std::vector<SCandidate> candidates(bins.size() * orientCount);
+        ParallelFor(candidates.size(), 1, [&](std::size_t begin, std::size_t end)
+        {
+            for(std::size_t i=begin; i<end; ++i)
+            {
+                const SBin& bin = bins[i / orientCount];
+                if(bin.freeArea < part.area)
+                    continue;
+                candidates[i].found = FindPosition(bin, part.orientations[i % orientCount], binWidth, binHeight, candidates[i].position);
+            }
+        });
+
+        std::size_t best = candidates.size();
+        for(std::size_t i=0; i<candidates.size(); ++i)
+        {
+            if(!candidates[i].found)
+                continue;
+            if(best != candidates.size() && i / orientCount != best / orientCount)
+                break;
+
+            const float top = candidates[i].position.y + part.orientations[i % orientCount].size.y;
+            const float bestTop = best == candidates.size() ? 0.0f : candidates[best].position.y + part.orientations[best % orientCount].size.y;
+            if(best == candidates.size() || top < bestTop || (top == bestTop && candidates[i].position.x < candidates[best].position.x))
+                best = i;
+        }
+
+        if(best == candidates.size())
+        {
+            bins.pop_back();
+            continue;
+        }
+        if(best / orientCount != bins.size() - 1)
+            bins.pop_back();
+
+        const std::size_t binIndex = best / orientCount;
+        const SOrientation& orientation = part.orientations[best % orientCount];
+        const vec2 position = candidates[best].position;
+        SBin& bin = bins[binIndex];
+        for(std::size_t p=0; p<orientation.pieces.size(); ++p)
+        {
+            ConvexPolygon piece = orientation.pieces[p];
+            for(vec2& v : piece)
+                v += position;
+            bin.pieces.push_back(std::move(piece));
+            bin.ranges.push_back(SRange{orientation.ranges[p].min + position, orientation.ranges[p].max + position});
+        }
+        bin.freeArea -= part.area;
+
+        placements[index].bin = binIndex;
+        placements[index].orientation = best % orientCount;
+        placements[index].offset = orientation.shift + position;
+    }
+
+    return placements;
+}
+} //namespace Nesting
@@ -0,0 +1,51 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NESTING_H
+#define NESTING_H
+#include <vector>
+#include <cstddef>
+#include <glm/vec2.hpp>
+#include "geometric/binPacking.h"
+
+//packing of parts by their real outlines, not bounding boxes
+namespace Nesting
+{
+using ConvexPolygon = std::vector<glm::vec2>; //counter-clockwise
+
+//splits outline given by triangles (3 consecutive vertices each) into convex pieces by merging
+//neighbouring triangles; outline is replaced by its convex hull if more than maxPieces remain
+std::vector<ConvexPolygon> GetConvexPieces(const std::vector<glm::vec2>& triangles, std::size_t maxPieces);
+
+struct SPart
+{
+    std::vector<std::vector<ConvexPolygon>> orientations; //same part, rotated in a few ways
+};
+
+struct SPlacement
+{
+    std::size_t bin = BinPacking::notPacked;
+    std::size_t orientation = 0;
+    glm::vec2   offset; //translation of the chosen orientation into the bin
+};
+
+//places every part at the lowest, then leftmost point of the first bin it fits in, using
+//no-fit polygons of its convex pieces; parts are kept 2*gap from each other and gap from bin borders
+std::vector<SPlacement> Nest(const std::vector<SPart>& parts, float binWidth, float binHeight, float gap);
+}
+
+#endif // NESTING_H
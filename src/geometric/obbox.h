@@ -46,6 +46,8 @@ private:
     std::array<glm::vec2, 4> points;
 };
 
+//counter-clockwise, without collinear points; coordinates are rounded to 0.001
+std::vector<glm::vec2> GetConvexHull(const std::vector<glm::vec2>& points);
 SOBBox GetMinOBBox(const std::vector<glm::vec2>& points, std::function<float(const SAABBox2D&)> criteria = nullptr);
 
 #endif // OBBOX_H
@@ -0,0 +1,267 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cassert>
+#include <glm/common.hpp>
+#include <glm/trigonometric.hpp>
+#include "geometric/trianglebatch.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TRIANGLEBATCH_SSE
+#include <xmmintrin.h>
+#endif
+#if defined(__AVX__)
+#define TRIANGLEBATCH_AVX
+#include <immintrin.h>
+#endif
+
+using glm::vec2;
+using glm::mat3;
+
+namespace
+{
+struct SStreams
+{
+    const float* relAX; const float* relAY; const float* relBX; const float* relBY;
+    const float* relTX; const float* relTY; const float* relTW;
+    const float* vtxX[3]; const float* vtxY[3];
+    const float* normX[3]; const float* normY[3];
+    float* posX; float* posY;
+    float* axisX; float* axisY;
+    float* vtxRX[3]; float* vtxRY[3];
+    float* vtxRTX[3]; float* vtxRTY[3];
+    float* normRX[3]; float* normRY[3];
+};
+
+struct SScalarLane
+{
+    using Type = float;
+    static const std::size_t width = 1;
+    static Type Splat(float f) { return f; }
+    static Type Load(const float* p) { return *p; }
+    static void Store(float* p, Type a) { *p = a; }
+    static Type Add(Type a, Type b) { return a + b; }
+    static Type Mul(Type a, Type b) { return a * b; }
+    static Type Min(Type a, Type b) { return b < a ? b : a; }
+    static Type Max(Type a, Type b) { return a < b ? b : a; }
+};
+
+#ifdef TRIANGLEBATCH_SSE
+struct SSSELane
+{
+    using Type = __m128;
+    static const std::size_t width = 4;
+    static Type Splat(float f) { return _mm_set1_ps(f); }
+    static Type Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, Type a) { _mm_storeu_ps(p, a); }
+    static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+    static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+    static Type Min(Type a, Type b) { return _mm_min_ps(a, b); }
+    static Type Max(Type a, Type b) { return _mm_max_ps(a, b); }
+};
+#endif
+
+#ifdef TRIANGLEBATCH_AVX
+struct SAVXLane
+{
+    using Type = __m256;
+    static const std::size_t width = 8;
+    static Type Splat(float f) { return _mm256_set1_ps(f); }
+    static Type Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, Type a) { _mm256_storeu_ps(p, a); }
+    static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+    static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+    static Type Min(Type a, Type b) { return _mm256_min_ps(a, b); }
+    static Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+};
+#endif
+
+//operations are done in the same order as glm does them for a single triangle,
+//so every lane width gives bit-identical results; returns index of first unprocessed triangle
+template<typename L>
+std::size_t TransformLanes(const SStreams& s, const mat3& parent, std::size_t i, std::size_t end)
+{
+    using T = typename L::Type;
+    const T g00 = L::Splat(parent[0][0]);
+    const T g01 = L::Splat(parent[0][1]);
+    const T g10 = L::Splat(parent[1][0]);
+    const T g11 = L::Splat(parent[1][1]);
+    const T g20 = L::Splat(parent[2][0]);
+    const T g21 = L::Splat(parent[2][1]);
+    const T one = L::Splat(1.0f);
+    const T minusOne = L::Splat(-1.0f);
+
+    auto clamp = [&one, &minusOne](T a) { return L::Min(L::Max(a, minusOne), one); };
+    auto rotate = [](T x, T y, T colX, T colY) { return L::Add(L::Mul(colX, x), L::Mul(colY, y)); };
+
+    for(; i + L::width <= end; i += L::width)
+    {
+        const T ax = L::Load(s.relAX + i);
+        const T ay = L::Load(s.relAY + i);
+        const T bx = L::Load(s.relBX + i);
+        const T by = L::Load(s.relBY + i);
+        const T tx = L::Load(s.relTX + i);
+        const T ty = L::Load(s.relTY + i);
+        const T tw = L::Load(s.relTW + i);
+
+        //rotation part is clamped, because it goes to acos later
+        const T rAX = clamp(rotate(ax, ay, g00, g10));
+        const T rAY = clamp(rotate(ax, ay, g01, g11));
+        const T rBX = clamp(rotate(bx, by, g00, g10));
+        const T rBY = clamp(rotate(bx, by, g01, g11));
+        const T px = L::Add(rotate(tx, ty, g00, g10), L::Mul(g20, tw));
+        const T py = L::Add(rotate(tx, ty, g01, g11), L::Mul(g21, tw));
+
+        L::Store(s.posX + i, px);
+        L::Store(s.posY + i, py);
+        L::Store(s.axisX + i, rAX);
+        L::Store(s.axisY + i, rAY);
+
+        for(int v=0; v<3; ++v)
+        {
+            const T vx = L::Load(s.vtxX[v] + i);
+            const T vy = L::Load(s.vtxY[v] + i);
+            const T rx = rotate(vx, vy, rAX, rBX);
+            const T ry = rotate(vx, vy, rAY, rBY);
+            L::Store(s.vtxRX[v] + i, rx);
+            L::Store(s.vtxRY[v] + i, ry);
+            L::Store(s.vtxRTX[v] + i, L::Add(rx, px));
+            L::Store(s.vtxRTY[v] + i, L::Add(ry, py));
+
+            const T nx = L::Load(s.normX[v] + i);
+            const T ny = L::Load(s.normY[v] + i);
+            L::Store(s.normRX[v] + i, rotate(nx, ny, rAX, rBX));
+            L::Store(s.normRY[v] + i, rotate(nx, ny, rAY, rBY));
+        }
+    }
+    return i;
+}
+}
+
+void CTriangleBatch::Clear()
+{
+    for(auto* stream : { &m_relAX, &m_relAY, &m_relBX, &m_relBY, &m_relTX, &m_relTY, &m_relTW })
+        stream->clear();
+    for(int v=0; v<3; ++v)
+    {
+        m_vtxX[v].clear();
+        m_vtxY[v].clear();
+        m_normX[v].clear();
+        m_normY[v].clear();
+    }
+}
+
+void CTriangleBatch::Reserve(std::size_t count)
+{
+    for(auto* stream : { &m_relAX, &m_relAY, &m_relBX, &m_relBY, &m_relTX, &m_relTY, &m_relTW })
+        stream->reserve(count);
+    for(int v=0; v<3; ++v)
+    {
+        m_vtxX[v].reserve(count);
+        m_vtxY[v].reserve(count);
+        m_normX[v].reserve(count);
+        m_normY[v].reserve(count);
+    }
+}
+
+void CTriangleBatch::Add(const mat3& relative, const vec2 (&vertices)[3], const vec2 (&normals)[3])
+{
+    //relative matrix is affine, so third row of rotation columns is zero
+    m_relAX.push_back(relative[0][0]);
+    m_relAY.push_back(relative[0][1]);
+    m_relBX.push_back(relative[1][0]);
+    m_relBY.push_back(relative[1][1]);
+    m_relTX.push_back(relative[2][0]);
+    m_relTY.push_back(relative[2][1]);
+    m_relTW.push_back(relative[2][2]);
+    for(int v=0; v<3; ++v)
+    {
+        m_vtxX[v].push_back(vertices[v].x);
+        m_vtxY[v].push_back(vertices[v].y);
+        m_normX[v].push_back(normals[v].x);
+        m_normY[v].push_back(normals[v].y);
+    }
+}
+
+void CTriangleBatch::Transform(const mat3& parent)
+{
+    const std::size_t count = Size();
+    for(auto* stream : { &m_posX, &m_posY, &m_axisX, &m_axisY, &m_rotation })
+        stream->resize(count);
+    for(int v=0; v<3; ++v)
+        for(auto* stream : { &m_vtxRX[v], &m_vtxRY[v], &m_vtxRTX[v], &m_vtxRTY[v], &m_normRX[v], &m_normRY[v] })
+            stream->resize(count);
+    if(count == 0)
+        return;
+
+    SStreams s;
+    s.relAX = m_relAX.data(); s.relAY = m_relAY.data();
+    s.relBX = m_relBX.data(); s.relBY = m_relBY.data();
+    s.relTX = m_relTX.data(); s.relTY = m_relTY.data(); s.relTW = m_relTW.data();
+    s.posX = m_posX.data(); s.posY = m_posY.data();
+    s.axisX = m_axisX.data(); s.axisY = m_axisY.data();
+    for(int v=0; v<3; ++v)
+    {
+        s.vtxX[v] = m_vtxX[v].data(); s.vtxY[v] = m_vtxY[v].data();
+        s.normX[v] = m_normX[v].data(); s.normY[v] = m_normY[v].data();
+        s.vtxRX[v] = m_vtxRX[v].data(); s.vtxRY[v] = m_vtxRY[v].data();
+        s.vtxRTX[v] = m_vtxRTX[v].data(); s.vtxRTY[v] = m_vtxRTY[v].data();
+        s.normRX[v] = m_normRX[v].data(); s.normRY[v] = m_normRY[v].data();
+    }
+
+    std::size_t i = 0;
+#ifdef TRIANGLEBATCH_AVX
+    i = TransformLanes<SAVXLane>(s, parent, i, count);
+#endif
+#ifdef TRIANGLEBATCH_SSE
+    i = TransformLanes<SSSELane>(s, parent, i, count);
+#endif
+    i = TransformLanes<SScalarLane>(s, parent, i, count);
+    assert(i == count);
+
+    //asin keeps the sign of its argument, so only acos is left per triangle
+    for(std::size_t j=0; j<count; ++j)
+        m_rotation[j] = glm::degrees(glm::acos(m_axisX[j])*glm::sign(m_axisY[j]));
+}
+
+vec2 CTriangleBatch::GetPosition(std::size_t i) const
+{
+    return vec2(m_posX[i], m_posY[i]);
+}
+
+float CTriangleBatch::GetRotation(std::size_t i) const
+{
+    return m_rotation[i];
+}
+
+vec2 CTriangleBatch::GetRotatedVertex(std::size_t i, int v) const
+{
+    assert(v >= 0 && v < 3);
+    return vec2(m_vtxRX[v][i], m_vtxRY[v][i]);
+}
+
+vec2 CTriangleBatch::GetTransformedVertex(std::size_t i, int v) const
+{
+    assert(v >= 0 && v < 3);
+    return vec2(m_vtxRTX[v][i], m_vtxRTY[v][i]);
+}
+
+vec2 CTriangleBatch::GetRotatedNormal(std::size_t i, int v) const
+{
+    assert(v >= 0 && v < 3);
+    return vec2(m_normRX[v][i], m_normRY[v][i]);
+}
@@ -0,0 +1,61 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TRIANGLEBATCH_H
+#define TRIANGLEBATCH_H
+#include <vector>
+#include <cstddef>
+#include <glm/vec2.hpp>
+#include <glm/mat3x3.hpp>
+
+//triangles of one parent frame, stored as structure of arrays, so whole batch
+//can be moved to world space in one SIMD sweep
+class CTriangleBatch
+{
+public:
+    void                Clear();
+    void                Reserve(std::size_t count);
+    //vertices and edge normals are in triangle's space, 'relative' places it in parent's space
+    void                Add(const glm::mat3& relative, const glm::vec2 (&vertices)[3], const glm::vec2 (&normals)[3]);
+    std::size_t         Size() const { return m_relTX.size(); }
+
+    //same math as parent * relative per triangle, but for all triangles at once
+    void                Transform(const glm::mat3& parent);
+
+    //results of the last Transform
+    glm::vec2           GetPosition(std::size_t i) const;
+    float               GetRotation(std::size_t i) const; //angle of triangle's rotation in degrees
+    glm::vec2           GetRotatedVertex(std::size_t i, int v) const;
+    glm::vec2           GetTransformedVertex(std::size_t i, int v) const;
+    glm::vec2           GetRotatedNormal(std::size_t i, int v) const;
+
+private:
+    //input
+    std::vector<float>  m_relAX, m_relAY, m_relBX, m_relBY; //rotation columns of relative matrix
+    std::vector<float>  m_relTX, m_relTY, m_relTW;
+    std::vector<float>  m_vtxX[3], m_vtxY[3];
+    std::vector<float>  m_normX[3], m_normY[3];
+    //output
+    std::vector<float>  m_posX, m_posY;
+    std::vector<float>  m_axisX, m_axisY;
+    std::vector<float>  m_rotation;
+    std::vector<float>  m_vtxRX[3], m_vtxRY[3];
+    std::vector<float>  m_vtxRTX[3], m_vtxRTY[3];
+    std::vector<float>  m_normRX[3], m_normRY[3];
+};
+
+#endif // TRIANGLEBATCH_H
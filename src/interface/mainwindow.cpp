@@ -259,14 +259,19 @@ void CMainWindow::LoadModel()
         if(importSettings.result() != QDialog::Accepted)
             return;
 
-        std::unique_ptr<CMesh> newModel(new CMesh());
-
-        newModel->LoadMesh(modelPath);
+        SModelData data;
+        const bool loaded = ImportInBackground([&modelPath](CLoadProgress& progress)
+        {
+            SModelData newModel;
+            newModel.mesh.reset(new CMesh());
+            newModel.mesh->LoadMesh(modelPath, &progress);
+            return newModel;
+        }, data);
+        if(!loaded)
+            return;
 
         m_openedModel = "";
-        m_model = std::move(newModel);
-        SetModelToWindows();
-        ClearTextures();
+        SetModelData(std::move(data));
 
         m_rw2->ZoomFit();
         m_rw3->ZoomFit();
@@ -275,7 +280,6 @@ void CMainWindow::LoadModel()
         NOTIFY(ModelStateChanged);
     } catch(std::exception& e)
     {
-        ClearModel();
         QMessageBox::information(this, "Error", e.what());
     }
 }
@@ -428,24 +432,25 @@ void CMainWindow::on_actionLoad_Model_triggered()
     if(decision == QMessageBox::Cancel)
         return;
 
-    ClearModel();
-
     try
     {
+        bool loaded = false;
         if(ivoModelPath.length() >=4 &&
            ivoModelPath.right(4) == ".ivo")
         {
-            LoadFromIVO(ivoModelPath);
+            loaded = LoadFromIVO(ivoModelPath);
         } else {
             switch(PdoTools::GetVersionPDO(ivoModelPath))
             {
             case 20:
-                LoadFromPDOv2_0(ivoModelPath);
+                loaded = LoadFromPDOv2_0(ivoModelPath);
                 break;
             default:
                 QMessageBox::information(this, "Error", "Unsupported PDO format version!");
             }
         }
+        if(!loaded)
+            return;
 
         m_rw2->ZoomFit();
         m_rw3->ZoomFit();
@@ -454,7 +459,6 @@ void CMainWindow::on_actionLoad_Model_triggered()
         NOTIFY(ModelStateChanged);
     } catch(std::exception& e)
     {
-        ClearModel();
         QMessageBox::warning(this, "Error", e.what());
     }
 }
@@ -24,8 +24,10 @@
 #include <memory>
 #include <unordered_map>
 #include <vector>
+#include <functional>
 #include "notification/notification.h"
 #include "notification/subscriber.h"
+#include "io/modeldata.h"
 
 namespace Ui {
 class MainWindow;
@@ -39,6 +41,7 @@ class CMesh;
 class CRenWin3D;
 class CRenWin2D;
 class CActionUpdater;
+class CLoadProgress;
 
 class CMainWindow : public QMainWindow, public Subscriber
 {
@@ -98,8 +101,10 @@ private:
     void OpenHelp() const;
     QMessageBox::StandardButton AskToSaveChanges();
     void SaveToIVO(const QString& filename);
-    void LoadFromIVO(const QString& filename);
-    void LoadFromPDOv2_0(const QString& filename);
+    bool LoadFromIVO(const QString& filename);
+    bool LoadFromPDOv2_0(const QString& filename);
+    bool ImportInBackground(const std::function<SModelData(CLoadProgress&)>& load, SModelData& data);
+    void SetModelData(SModelData&& data);
     void UpdateStyle();
     void SetupGUI();
 
@@ -0,0 +1,128 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <QString>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QEventLoop>
+#include <QTimer>
+#include <stdexcept>
+#include <future>
+#include <chrono>
+#include "interface/mainwindow.h"
+#include "ivo/ivoloader.h"
+#include "pdo/pdoloader.h"
+#include "mesh/mesh.h"
+#include "io/loadprogress.h"
+
+void CMainWindow::SaveToIVO(const QString& filename)
+{
+    try
+    {
+        IvoLoader::SaveToIVO(filename, *m_model, m_textures, m_textureImages);
+    } catch(std::exception& e)
+    {
+        QMessageBox::warning(this, "Error", e.what());
+        return;
+    }
+    m_openedModel = filename;
+    m_modelModified = false;
+}
+
+bool CMainWindow::LoadFromIVO(const QString& filename)
+{
+    SModelData data;
+    if(!ImportInBackground([filename](CLoadProgress& progress) { return IvoLoader::LoadFromIVO(filename, &progress); }, data))
+        return false;
+
+    IvoLoader::ApplyStoredSettings(data);
+    m_openedModel = filename;
+    SetModelData(std::move(data));
+    return true;
+}
+
+bool CMainWindow::LoadFromPDOv2_0(const QString& filename)
+{
+    SModelData data;
+    if(!ImportInBackground([filename](CLoadProgress& progress) { return PdoTools::LoadPDOv2_0(filename, &progress); }, data))
+        return false;
+
+    m_openedModel = "";
+    SetModelData(std::move(data));
+    return true;
+}
+
+//runs load on worker thread while window shows its progress; returns false if user cancelled it.
+//current model stays untouched until the new one is complete, dialog blocks input from the start
+bool CMainWindow::ImportInBackground(const std::function<SModelData(CLoadProgress&)>& load, SModelData& data)
+{
+    CLoadProgress progress;
+    std::future<SModelData> result = std::async(std::launch::async, [&load, &progress]() { return load(progress); });
+
+    QProgressDialog dialog(this);
+    dialog.setWindowTitle("Import");
+    dialog.setWindowModality(Qt::WindowModal);
+    dialog.setAutoReset(false);
+    dialog.setAutoClose(false);
+    dialog.setMinimumDuration(0);
+    dialog.setRange(0, 100);
+    dialog.show();
+    connect(&dialog, &QProgressDialog::canceled, [&progress]() { progress.Cancel(); });
+
+    QEventLoop loop;
+    QTimer poll;
+    connect(&poll, &QTimer::timeout, [&]()
+    {
+        if(result.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            loop.quit();
+            return;
+        }
+        dialog.setLabelText(CLoadProgress::GetStageName(progress.GetStage()));
+        dialog.setValue(static_cast<int>(progress.GetStageFraction() * 100.0f));
+    });
+    poll.start(30);
+    loop.exec();
+    poll.stop();
+    dialog.close();
+
+    try
+    {
+        data = result.get();
+    } catch(CLoadCancelled&)
+    {
+        return false;
+    }
+    return true;
+}
+
+void CMainWindow::SetModelData(SModelData&& data)
+{
+    m_modelModified = false;
+    m_model = std::move(data.mesh);
+    SetModelToWindows();
+    ClearTextures();
+
+    for(auto& path : data.texturePaths)
+        m_textures[path.first] = path.second;
+    for(auto& image : data.textureImages)
+    {
+        m_textureImages[image.first] = std::move(image.second);
+        if(m_textureImages[image.first])
+            emit UpdateTexture(m_textureImages[image.first].get(), image.first);
+    }
+}
@@ -26,7 +26,7 @@ bool CModeFlaps::MouseLBPress()
     int edgeUnderCursor = 0;
     EditInfo().mesh->GetStuffUnderCursor(mouseWorldCoords, trUnderCursor, edgeUnderCursor);
     if(trUnderCursor)
-        trUnderCursor->GetEdge(edgeUnderCursor)->NextFlapPosition();
+        EditInfo().mesh->NextFlapPosition(*trUnderCursor->GetEdge(edgeUnderCursor));
 
     Deactivate();
     return true;
@@ -21,14 +21,22 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QMenu>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QProgressDialog>
 #include <glm/geometric.hpp>
 #include <glm/trigonometric.hpp>
 #include <limits>
 #include <cassert>
+#include <atomic>
+#include <vector>
 #include "mesh/mesh.h"
 #include "interface/renwin2d.h"
 #include "settings/settings.h"
 #include "renderers/renderlegacy2d.h"
+#include "renderers/rendervbo2d.h"
 #include "interface/editinfo2d.h"
 #include "interface/modes2D/mode2D.h"
 
@@ -48,6 +56,55 @@ using glm::abs;
 using glm::max;
 using glm::min;
 
+namespace
+{
+//encodes and writes one rendered sheet on a worker thread
+class CSheetWriter : public QRunnable
+{
+public:
+    CSheetWriter(const QImage& img, const QString& path, const QByteArray& format, int quality,
+                 QSemaphore& freeSlots, std::atomic<bool>& failed, std::atomic<bool>& cancelled, std::atomic<int>& written) :
+        m_img(img),
+        m_path(path),
+        m_format(format),
+        m_quality(quality),
+        m_freeSlots(freeSlots),
+        m_failed(failed),
+        m_cancelled(cancelled),
+        m_written(written)
+    {
+    }
+
+    //slot is freed here, so that writers removed from pool without running free it too
+    ~CSheetWriter()
+    {
+        m_freeSlots.release();
+    }
+
+    void run() override
+    {
+        if(!m_cancelled && !m_failed)
+        {
+            if(m_img.save(m_path, m_format.constData(), m_quality))
+                ++m_written;
+            else
+                m_failed = true;
+        }
+        m_img = QImage();
+    }
+
+private:
+    QImage              m_img;
+    const QString       m_path;
+    const QByteArray    m_format;
+    const int           m_quality;
+    QSemaphore&         m_freeSlots;
+    std::atomic<bool>&  m_failed;
+    std::atomic<bool>&  m_cancelled;
+    std::atomic<int>&   m_written;
+};
+}
+
 CRenWin2D::CRenWin2D(QWidget *parent) :
     IRenWin(parent),
     m_showMenu(false),
@@ -101,7 +158,9 @@ void CRenWin2D::SetModel(CMesh* mdl)
     ClearSelection();
     m_model = mdl;
     m_editInfo->mesh = mdl;
+    makeCurrent();
     m_renderer->SetModel(mdl);
+    doneCurrent();
     ZoomFit();
 }
 
@@ -131,7 +190,10 @@ void CRenWin2D::initializeGL()
     QOpenGLFunctions_2_0* gfx = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_2_0>();
     if(!gfx)
         throw std::logic_error("OpenGL 2.0 is not available!");
-    m_renderer.reset(new CRenderer2DLegacy(*gfx));
+    if(CSettings::GetInstance().GetRendererBackend() == CSettings::RB_VBO)
+        m_renderer.reset(new CRenderer2DVBO(*gfx));
+    else
+        m_renderer.reset(new CRenderer2DLegacy(*gfx));
     m_renderer->Init();
     RecalcProjection();
 }
@@ -212,41 +274,99 @@ void CRenWin2D::ExportSheets(const QString baseName)
         default: assert(false);
     }
 
-    makeCurrent();
-
-    int sheetNum = 1;
+    std::vector<vec2> sheets;
     for(unsigned x=0; x<papHorizontal; x++)
     for(unsigned y=0; y<papVertical; y++)
     {
         const vec2 sheetPos(x * papWidth * 0.1f, (y+1) * (papHeight * 0.1f) * -1.0f);
-        if(!m_model->Intersects(
+        if(m_model->Intersects(
                     SAABBox2D(vec2(sheetPos.x + papWidth * 0.1f, sheetPos.y),
                               vec2(sheetPos.x, sheetPos.y + papHeight * 0.1f))
                     ))
-            continue;
+            sheets.push_back(sheetPos);
+    }
+    const int numSheets = static_cast<int>(sheets.size());
+
+    //sheet N+1 is rendered while workers encode previous ones;
+    //number of rendered but not yet written images is bounded
+    const int numWorkers = qMax(1, QThread::idealThreadCount() - 1);
+    QThreadPool writers;
+    writers.setMaxThreadCount(numWorkers);
+    QSemaphore freeSlots(numWorkers + 1);
+    std::atomic<bool> failed(false);
+    std::atomic<bool> cancelled(false);
+    std::atomic<int> written(0);
+
+    QProgressDialog progress("Exporting sheets...", "Cancel", 0, numSheets, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+    //writers that have not started yet are dropped, only sheets already being written are completed
+    connect(&progress, &QProgressDialog::canceled, [&cancelled, &writers]()
+    {
+        cancelled = true;
+        writers.clear();
+    });
+
+    QString renderError;
+    for(int i=0; i<numSheets && !failed; ++i)
+    {
+        while(!freeSlots.tryAcquire(1, 30))
+            progress.setValue(written);
+        if(progress.wasCanceled())
+        {
+            freeSlots.release();
+            break;
+        }
 
         QImage img;
+        makeCurrent();
         try
         {
-            img = m_renderer->DrawImageFromSheet(sheetPos);
+            img = m_renderer->DrawImageFromSheet(sheets[i]);
         } catch(std::exception& error)
         {
-            QMessageBox::information(this, "Export Error", error.what());
-            doneCurrent();
-            return;
+            renderError = error.what();
         }
+        doneCurrent();
 
-        if(!img.save(dstFolder + baseName + "_" + QString::number(sheetNum++) + "." + imgFormat.toLower(),
-                     imgFormat.toStdString().c_str(),
-                     imgQuality))
+        if(!renderError.isEmpty())
         {
-            QMessageBox::information(this, "Export Error", "Failed to save one of image files!");
-            doneCurrent();
-            return;
+            freeSlots.release();
+            break;
         }
+
+        writers.start(new CSheetWriter(img,
+                                       dstFolder + baseName + "_" + QString::number(i+1) + "." + imgFormat.toLower(),
+                                       imgFormat.toLatin1(),
+                                       imgQuality,
+                                       freeSlots, failed, cancelled, written));
+        progress.setValue(written);
     }
 
-    doneCurrent();
+    cancelled = progress.wasCanceled() || !renderError.isEmpty();
+    while(!writers.waitForDone(30))
+    {
+        progress.setValue(written);
+        if(progress.wasCanceled())
+            cancelled = true;
+    }
+    progress.hide();
+
+    if(!renderError.isEmpty())
+    {
+        QMessageBox::information(this, "Export Error", renderError);
+        return;
+    }
+    if(failed)
+    {
+        QMessageBox::information(this, "Export Error", "Failed to save one of image files!");
+        return;
+    }
+    if(cancelled)
+    {
+        QMessageBox::information(this, "Export", "Export has been cancelled.");
+        return;
+    }
 
     QMessageBox::information(this, "Export", "Images have been exported successfully!");
 }
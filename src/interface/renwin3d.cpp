@@ -25,6 +25,7 @@
 #include "renwin3d.h"
 #include "mesh/mesh.h"
 #include "renderers/renderlegacy3d.h"
+#include "renderers/rendervbo3d.h"
 #include "geometric/compgeom.h"
 
 static const int g_UpdateEvent = QEvent::registerEventType();
@@ -55,7 +56,9 @@ CRenWin3D::~CRenWin3D()
 void CRenWin3D::SetModel(CMesh *mdl)
 {
     m_model = mdl;
+    makeCurrent();
     m_renderer->SetModel(mdl);
+    doneCurrent();
     ZoomFit();
 }
 
@@ -90,7 +93,10 @@ void CRenWin3D::initializeGL()
     QOpenGLFunctions_2_0* gfx = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_2_0>();
     if(!gfx)
         throw std::logic_error("OpenGL 2.0 is not available!");
-    m_renderer.reset(new CRenderer3DLegacy(*gfx));
+    if(CSettings::GetInstance().GetRendererBackend() == CSettings::RB_VBO)
+        m_renderer.reset(new CRenderer3DVBO(*gfx));
+    else
+        m_renderer.reset(new CRenderer3DLegacy(*gfx));
     UpdateViewAngles();
     m_renderer->Init();
     m_updateTimer.start();
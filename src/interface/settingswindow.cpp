@@ -43,6 +43,7 @@ void CSettingsWindow::LoadSettings()
     ui->spinBoxH->setValue(s.GetPaperHeight());
     ui->spinBoxHMargs->setValue(s.GetMarginsHorizontal());
     ui->spinBoxVMargs->setValue(s.GetMarginsVertical());
+    ui->comboBoxPacking->setCurrentIndex((int)s.GetPackingAlgorithm());
 }
 
 void CSettingsWindow::SaveSettings() const
@@ -51,12 +52,14 @@ void CSettingsWindow::SaveSettings() const
     unsigned papH = (unsigned)ui->spinBoxH->value();
     unsigned margH = (unsigned)ui->spinBoxHMargs->value();
     unsigned margV = (unsigned)ui->spinBoxVMargs->value();
+    CSettings::PackingAlgorithm packing = (CSettings::PackingAlgorithm)ui->comboBoxPacking->currentIndex();
 
     CSettings& s = CSettings::GetInstance();
     s.SetPaperWidth(papW);
     s.SetPaperHeight(papH);
     s.SetMarginsHorizontal(margH);
     s.SetMarginsVertical(margV);
+    s.SetPackingAlgorithm(packing);
 }
 
 void CSettingsWindow::on_buttonBox_accepted()
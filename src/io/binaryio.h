@@ -0,0 +1,121 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef IVO_BINARY_IO_H
+#define IVO_BINARY_IO_H
+#include <QByteArray>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//appends raw (native byte order) data to byte array; T must be plain data: scalars, enums, glm types
+class CBinaryWriter
+{
+public:
+    explicit CBinaryWriter(QByteArray& out) : m_out(out) {}
+
+    template<typename T>
+    void Write(const T& val)
+    {
+        m_out.append(reinterpret_cast<const char*>(&val), static_cast<int>(sizeof(T)));
+    }
+
+    void WriteRaw(const void* data, std::size_t size)
+    {
+        m_out.append(reinterpret_cast<const char*>(data), static_cast<int>(size));
+    }
+
+    //element count followed by elements
+    template<typename T>
+    void WriteArray(const std::vector<T>& vec)
+    {
+        Write(static_cast<std::uint64_t>(vec.size()));
+        if(!vec.empty())
+            WriteRaw(vec.data(), vec.size() * sizeof(T));
+    }
+
+    void WriteString(const std::string& str)
+    {
+        Write(static_cast<std::uint64_t>(str.size()));
+        WriteRaw(str.data(), str.size());
+    }
+
+    std::size_t Size() const { return static_cast<std::size_t>(m_out.size()); }
+
+private:
+    QByteArray& m_out;
+};
+
+//reads data written by CBinaryWriter from memory block (e.g. mapped file), never reads past its end
+class CBinaryReader
+{
+public:
+    CBinaryReader(const unsigned char* data, std::size_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+    template<typename T>
+    T Read()
+    {
+        T val;
+        std::memcpy(&val, Advance(sizeof(T)), sizeof(T));
+        return val;
+    }
+
+    //returns pointer to next 'size' bytes and skips them
+    const unsigned char* ReadRaw(std::size_t size) { return Advance(size); }
+
+    template<typename T>
+    void ReadArray(std::vector<T>& vec)
+    {
+        const std::uint64_t count = Read<std::uint64_t>();
+        if(count > (m_size - m_pos) / sizeof(T))
+            Corrupted();
+        vec.resize(static_cast<std::size_t>(count));
+        if(count > 0)
+            std::memcpy(vec.data(), Advance(vec.size() * sizeof(T)), vec.size() * sizeof(T));
+    }
+
+    std::string ReadString()
+    {
+        const std::uint64_t size = Read<std::uint64_t>();
+        if(size > m_size - m_pos)
+            Corrupted();
+        const char* str = reinterpret_cast<const char*>(Advance(static_cast<std::size_t>(size)));
+        return std::string(str, static_cast<std::size_t>(size));
+    }
+
+    std::size_t Remaining() const { return m_size - m_pos; }
+
+private:
+    const unsigned char* Advance(std::size_t size)
+    {
+        if(size > m_size - m_pos)
+            Corrupted();
+        const unsigned char* ptr = m_data + m_pos;
+        m_pos += size;
+        return ptr;
+    }
+
+    static void Corrupted() { throw std::runtime_error("File corrupted: unexpected end of data!"); }
+
+    const unsigned char* m_data;
+    std::size_t          m_size;
+    std::size_t          m_pos;
+};
+
+#endif // IVO_BINARY_IO_H
@@ -0,0 +1,88 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include "io/loadprogress.h"
+
+CLoadProgress::CLoadProgress() :
+    m_stage(S_READ),
+    m_total(0),
+    m_done(0),
+    m_cancelled(false)
+{
+}
+
+void CLoadProgress::BeginStage(EStage stage, std::size_t total)
+{
+    Check();
+    m_done.store(0, std::memory_order_relaxed);
+    m_total.store(total, std::memory_order_relaxed);
+    m_stage.store(stage, std::memory_order_relaxed);
+}
+
+void CLoadProgress::SetDone(std::size_t done)
+{
+    m_done.store(done, std::memory_order_relaxed);
+}
+
+void CLoadProgress::Advance(std::size_t count)
+{
+    m_done.fetch_add(count, std::memory_order_relaxed);
+    Check();
+}
+
+void CLoadProgress::Check() const
+{
+    if(IsCancelled())
+        throw CLoadCancelled();
+}
+
+void CLoadProgress::Cancel()
+{
+    m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool CLoadProgress::IsCancelled() const
+{
+    return m_cancelled.load(std::memory_order_relaxed);
+}
+
+CLoadProgress::EStage CLoadProgress::GetStage() const
+{
+    return static_cast<EStage>(m_stage.load(std::memory_order_relaxed));
+}
+
+float CLoadProgress::GetStageFraction() const
+{
+    const std::size_t total = m_total.load(std::memory_order_relaxed);
+    const std::size_t done = m_done.load(std::memory_order_relaxed);
+    if(total == 0)
+        return 0.0f;
+    return std::min(1.0f, static_cast<float>(done) / static_cast<float>(total));
+}
+
+const char* CLoadProgress::GetStageName(EStage stage)
+{
+    switch(stage)
+    {
+        case S_READ :      return "Reading file";
+        case S_ADJACENCY : return "Finding adjacent triangles";
+        case S_GROUPING :  return "Grouping triangles";
+        case S_PACKING :   return "Packing groups";
+        default:           return "";
+    }
+}
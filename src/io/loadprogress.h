@@ -0,0 +1,69 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LOADPROGRESS_H
+#define LOADPROGRESS_H
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+//thrown by CLoadProgress::Check() once cancellation is requested
+class CLoadCancelled : public std::runtime_error
+{
+public:
+    CLoadCancelled() : std::runtime_error("Import was cancelled") {}
+};
+
+//progress of a model import, written by the loading thread and polled by another one;
+//loaders call Advance() or Check() in long loops, which throw CLoadCancelled after Cancel().
+//SetDone() never throws, so it can be called from code that must not be unwound, e.g. callbacks of assimp
+class CLoadProgress
+{
+public:
+    enum EStage
+    {
+        S_READ,
+        S_ADJACENCY,
+        S_GROUPING,
+        S_PACKING,
+        S_COUNT
+    };
+
+    CLoadProgress();
+    CLoadProgress(const CLoadProgress&) = delete;
+    CLoadProgress& operator=(const CLoadProgress&) = delete;
+
+    void        BeginStage(EStage stage, std::size_t total);
+    void        SetDone(std::size_t done);
+    void        Advance(std::size_t count = 1);
+    void        Check() const;
+    void        Cancel();
+    bool        IsCancelled() const;
+
+    EStage      GetStage() const;
+    float       GetStageFraction() const;
+
+    static const char* GetStageName(EStage stage);
+
+private:
+    std::atomic<int>         m_stage;
+    std::atomic<std::size_t> m_total;
+    std::atomic<std::size_t> m_done;
+    std::atomic<bool>        m_cancelled;
+};
+
+#endif // LOADPROGRESS_H
@@ -0,0 +1,53 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef IVO_MODELDATA_H
+#define IVO_MODELDATA_H
+#include <QImage>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class CMesh;
+
+//paper and rendering settings saved along with model
+struct SStoredSettings
+{
+    unsigned char   renderFlags;
+    unsigned        paperWidth;
+    unsigned        paperHeight;
+    unsigned        marginsHorizontal;
+    unsigned        marginsVertical;
+    float           resolutionScale;
+    int             imageFormat;
+    unsigned char   imageQuality;
+    float           lineWidth;
+    unsigned        stippleLoop;
+    unsigned char   foldMaxFlatAngle;
+};
+
+//model together with textures of its materials, as stored in files;
+//loaders do not touch CSettings, so stored settings are applied by caller
+struct SModelData
+{
+    std::unique_ptr<CMesh>                                  mesh;
+    std::unique_ptr<SStoredSettings>                        settings; //null if file stores none
+    std::unordered_map<unsigned, std::string>               texturePaths;
+    std::unordered_map<unsigned, std::unique_ptr<QImage>>   textureImages;
+};
+
+#endif
@@ -17,10 +17,62 @@
 */
 #include <string>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include <stdexcept>
 #include "saferead.h"
 
-CSafeFile::CSafeFile(const std::string& path)
+namespace
+{
+const std::size_t g_ChunkSize = 64 * 1024;
+
+inline bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+inline void SkipSpaces(const char*& str)
+{
+    while(IsSpace(*str))
+        ++str;
+}
+
+bool ParseInteger(const char*& line, long long& val)
+{
+    SkipSpaces(line);
+    const char* cur = line;
+    const bool negative = *cur == '-';
+    if(*cur == '-' || *cur == '+')
+        ++cur;
+    if(*cur < '0' || *cur > '9')
+        return false;
+
+    long long result = 0;
+    while(*cur >= '0' && *cur <= '9')
+        result = result * 10 + (*(cur++) - '0');
+
+    val = negative ? -result : result;
+    line = cur;
+    return true;
+}
+
+bool ParseFloat(const char*& line, float& val)
+{
+    SkipSpaces(line);
+    char* end = nullptr;
+    const float result = std::strtof(line, &end);
+    if(end == line)
+        return false;
+
+    val = result;
+    line = end;
+    return true;
+}
+}
+
+CSafeFile::CSafeFile(const std::string& path) :
+    m_buffer(g_ChunkSize)
 {
     m_file = std::fopen(path.c_str(), "rb");
 }
@@ -41,29 +93,71 @@ void CSafeFile::BadFile()
     throw std::runtime_error("Error reading from file!");
 }
 
-std::string CSafeFile::ReadLine()
+bool CSafeFile::Refill()
 {
-    std::string line = "";
-    char tmp;
-    while(1)
+    if(m_begin > 0)
+    {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+        m_end -= m_begin;
+        m_begin = 0;
+    }
+    //line does not fit into buffer
+    if(m_end == m_buffer.size())
+        m_buffer.resize(m_buffer.size() * 2);
+
+    const std::size_t read = std::fread(m_buffer.data() + m_end, 1, m_buffer.size() - m_end, m_file);
+    m_end += read;
+    return read > 0;
+}
+
+//returns zero-terminated line without '\n', that stays valid until the next read
+const char* CSafeFile::NextLine()
+{
+    SafetyCheck();
+
+    std::size_t searchOffset = 0;
+    while(true)
     {
-        if(std::feof(m_file))
-            break;
-        size_t read = std::fread(&tmp, 1, 1, m_file);
-        if(read != 1)
+        const std::size_t searchFrom = m_begin + searchOffset;
+        char* lineEnd = static_cast<char*>(std::memchr(m_buffer.data() + searchFrom, '\n', m_end - searchFrom));
+        if(lineEnd)
+        {
+            *lineEnd = '\0';
+            const char* line = m_buffer.data() + m_begin;
+            m_begin = static_cast<std::size_t>(lineEnd - m_buffer.data()) + 1;
+            return line;
+        }
+
+        searchOffset = m_end - m_begin;
+        //no line terminator before end of file
+        if(!Refill())
             BadFile();
-        if(tmp == '\n')
-            break;
-        line += (tmp);
     }
-    return line;
+}
+
+std::string CSafeFile::ReadLine()
+{
+    const char* line = NextLine();
+    return std::string(line, static_cast<std::size_t>(m_buffer.data() + m_begin - 1 - line));
+}
+
+void CSafeFile::SkipLine()
+{
+    NextLine();
 }
 
 void CSafeFile::ReadBuffer(void* buffer, std::size_t elemSize, std::size_t numElems)
 {
     SafetyCheck();
 
-    if(std::fread(buffer, elemSize, numElems, m_file) != numElems)
+    const std::size_t size = elemSize * numElems;
+    const std::size_t fromBuffer = std::min(size, m_end - m_begin);
+    std::memcpy(buffer, m_buffer.data() + m_begin, fromBuffer);
+    m_begin += fromBuffer;
+
+    //large blocks bypass the buffer
+    const std::size_t rest = size - fromBuffer;
+    if(rest > 0 && std::fread(static_cast<char*>(buffer) + fromBuffer, 1, rest, m_file) != rest)
         BadFile();
 }
 
@@ -79,3 +173,66 @@ void CSafeFile::Close()
         std::fclose(m_file);
     m_file = nullptr;
 }
+
+//processes format up to the next assigned conversion, false if input does not match format
+bool CSafeFile::ScanToConversion(const char*& format, const char*& line)
+{
+    while(*format)
+    {
+        if(IsSpace(*format))
+        {
+            SkipSpaces(format);
+            SkipSpaces(line);
+            continue;
+        }
+        if(*format != '%' || format[1] == '%')
+        {
+            if(*format == '%')
+                ++format;
+            if(*line != *format)
+                return false;
+            ++format;
+            ++line;
+            continue;
+        }
+
+        ++format;
+        const bool suppressed = *format == '*';
+        if(suppressed)
+            ++format;
+        while(*format == 'z' || *format == 'l' || *format == 'h')
+            ++format;
+        const char conversion = *(format++);
+        if(!suppressed)
+            return true;
+
+        long long intVal;
+        float floatVal;
+        if(conversion == 'f' ? !ParseFloat(line, floatVal) : !ParseInteger(line, intVal))
+            return false;
+    }
+    return false;
+}
+
+bool CSafeFile::ParseValue(const char*& line, int* out)
+{
+    long long val;
+    if(!ParseInteger(line, val))
+        return false;
+    *out = static_cast<int>(val);
+    return true;
+}
+
+bool CSafeFile::ParseValue(const char*& line, std::size_t* out)
+{
+    long long val;
+    if(!ParseInteger(line, val))
+        return false;
+    *out = static_cast<std::size_t>(val);
+    return true;
+}
+
+bool CSafeFile::ParseValue(const char*& line, float* out)
+{
+    return ParseFloat(line, *out);
+}
@@ -18,9 +18,11 @@
 #ifndef SAFEREAD_H
 #define SAFEREAD_H
 #include <cstdio>
+#include <cstddef>
 #include <string>
-#include <tuple>
+#include <vector>
 
+//buffered reader of text files with embedded binary blocks; throws on any read past end of file
 class CSafeFile
 {
 public:
@@ -33,26 +35,49 @@ public:
     CSafeFile& operator=(CSafeFile&&) = delete;
     operator bool() const;
 
+    //subset of scanf: literals, whitespaces, %d, %zd, %f and their suppressed (%*) versions
     template<typename...Args>
-    void        LineScanf(Args&&... args);
+    void        LineScanf(const char* format, Args*... args);
     void        ReadBuffer(void* buffer, std::size_t elemSize, std::size_t numElems);
     void        SafetyCheck();
     std::string ReadLine();
+    void        SkipLine();
 
 private:
-    void BadFile();
-    void Close();
+    void        BadFile();
+    void        Close();
+    const char* NextLine();
+    bool        Refill();
 
-    std::FILE* m_file = nullptr;
+    template<typename T, typename...Rest>
+    static int  Scan(const char*& format, const char*& line, T* out, Rest*... rest);
+    static int  Scan(const char*&, const char*&) { return 0; }
+    static bool ScanToConversion(const char*& format, const char*& line);
+    static bool ParseValue(const char*& line, int* out);
+    static bool ParseValue(const char*& line, std::size_t* out);
+    static bool ParseValue(const char*& line, float* out);
+
+    std::FILE*        m_file = nullptr;
+    std::vector<char> m_buffer;
+    std::size_t       m_begin = 0; //unread data is [m_begin, m_end)
+    std::size_t       m_end = 0;
 };
 
 //--------------------------------------------------------
 template<typename...Args>
-void CSafeFile::LineScanf(Args&&... args)
+void CSafeFile::LineScanf(const char* format, Args*... args)
 {
-    SafetyCheck();
-    if(std::sscanf(ReadLine().c_str(), args...) != sizeof...(args)-1)
+    const char* line = NextLine();
+    if(Scan(format, line, args...) != static_cast<int>(sizeof...(args)))
         BadFile();
 }
 
+template<typename T, typename...Rest>
+int CSafeFile::Scan(const char*& format, const char*& line, T* out, Rest*... rest)
+{
+    if(!ScanToConversion(format, line) || !ParseValue(line, out))
+        return 0;
+    return 1 + Scan(format, line, rest...);
+}
+
 #endif // SAFEREAD_H
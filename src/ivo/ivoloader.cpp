@@ -16,17 +16,61 @@
     along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <QString>
-#include <QMessageBox>
 #include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonParseError>
-#include "interface/mainwindow.h"
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include "ivo/ivoloader.h"
 #include "mesh/mesh.h"
 #include "settings/settings.h"
+#include "io/binaryio.h"
+#include "io/loadprogress.h"
 
-void CMainWindow::SaveToIVO(const QString& filename)
+
+namespace
+{
+//binary container: header, table of sections, sections data
+const char          g_BinaryMagic[4] = { 'I', 'V', 'O', 'B' };
+const std::uint32_t g_BinaryVersion = 1u;
+const std::uint32_t g_ByteOrderMark = 0x01020304u;
+
+enum ESection : std::uint32_t
+{
+    S_SETTINGS = 1,
+    S_MESH,
+    S_MATERIALS
+};
+
+struct SSectionEntry
+{
+    std::uint32_t id;
+    std::uint32_t reserved;
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+void WriteToFile(const QString& filename, const QByteArray& data)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        throw std::runtime_error((QString("Failed to open '") + filename + "' for writing.").toStdString());
+    }
+    auto writtenSize = file.write(data);
+    if(writtenSize != data.size())
+    {
+        throw std::runtime_error("Failed to write data to file! Contents might be corrupted.");
+    }
+}
+
+QByteArray SerializeJSON(const CMesh&                                                    mesh,
+                         const std::unordered_map<unsigned, std::string>&                texturePaths,
+                         const std::unordered_map<unsigned, std::unique_ptr<QImage>>&    textureImages)
 {
     const CSettings& sett = CSettings::GetInstance();
 
@@ -43,21 +87,22 @@ void CMainWindow::SaveToIVO(const QString& filename)
     root.insert("lineWidth", sett.GetLineWidth());
     root.insert("stippleLoop", static_cast<int>(sett.GetStippleLoop()));
     root.insert("maxFlatAngle", sett.GetFoldMaxFlatAngle());
-    root.insert("mesh", m_model->Serialize());
+    root.insert("mesh", mesh.Serialize());
 
     QJsonArray matArray;
-    auto materials = m_model->GetMaterials();
+    auto materials = mesh.GetMaterials();
     for(auto it=materials.begin(); it!=materials.end(); it++)
     {
         auto index = static_cast<int>(it->first);
         std::string matName = it->second;
-        std::string texPath = m_textures[index];
-        const QImage* image = m_textureImages[index].get();
+        const auto texPath = texturePaths.find(it->first);
+        const auto texImage = textureImages.find(it->first);
+        const QImage* image = texImage != textureImages.end() ? texImage->second.get() : nullptr;
 
         QJsonObject matEntry;
         matEntry.insert("index", index);
         matEntry.insert("name", matName.c_str());
-        matEntry.insert("path", texPath.c_str());
+        matEntry.insert("path", texPath != texturePaths.end() ? texPath->second.c_str() : "");
 
         if(image)
         {
@@ -79,43 +124,105 @@ void CMainWindow::SaveToIVO(const QString& filename)
     }
     root.insert("materials", matArray);
 
-    QFile file(filename);
-    if(!file.open(QIODevice::WriteOnly))
-    {
-        QMessageBox::warning(this, "Error", QString("Failed to open '") + filename + "' for writing.");
-        return;
-    }
     QJsonDocument doc;
     doc.setObject(root);
-    const QByteArray docData = doc.toJson(QJsonDocument::Indented);
-    auto writtenSize = file.write(docData);
-    if(writtenSize != docData.size())
+    return doc.toJson(QJsonDocument::Indented);
+}
+
+QByteArray SerializeBinary(const CMesh&                                                    mesh,
+                           const std::unordered_map<unsigned, std::string>&                texturePaths,
+                           const std::unordered_map<unsigned, std::unique_ptr<QImage>>&    textureImages)
+{
+    const CSettings& sett = CSettings::GetInstance();
+
+    QByteArray settingsData;
     {
-        QMessageBox::warning(this, "Error", QString("Failed to write data to file! Contents might be corrupted."));
+        CBinaryWriter writer(settingsData);
+        writer.Write(static_cast<std::uint8_t>(sett.GetRenderFlags()));
+        writer.Write(static_cast<std::uint32_t>(sett.GetPaperWidth()));
+        writer.Write(static_cast<std::uint32_t>(sett.GetPaperHeight()));
+        writer.Write(static_cast<std::uint32_t>(sett.GetMarginsHorizontal()));
+        writer.Write(static_cast<std::uint32_t>(sett.GetMarginsVertical()));
+        writer.Write(static_cast<float>(sett.GetResolutionScale()));
+        writer.Write(static_cast<std::uint32_t>(sett.GetImageFormat()));
+        writer.Write(static_cast<std::uint8_t>(sett.GetImageQuality()));
+        writer.Write(static_cast<float>(sett.GetLineWidth()));
+        writer.Write(static_cast<std::uint32_t>(sett.GetStippleLoop()));
+        writer.Write(static_cast<std::uint8_t>(sett.GetFoldMaxFlatAngle()));
     }
-    else
+
+    QByteArray meshData;
     {
-        m_openedModel = filename;
-        m_modelModified = false;
+        CBinaryWriter writer(meshData);
+        mesh.Serialize(writer);
     }
-}
 
-void CMainWindow::LoadFromIVO(const QString& filename)
-{
-    QFile file(filename);
-    if(!file.open(QIODevice::ReadOnly))
+    //textures are stored as zlib blobs, ready to be uncompressed right from mapped file
+    QByteArray materialsData;
     {
-        QMessageBox::warning(this, "Error", QString("Failed to open '") + filename + "' for reading.");
-        return;
+        CBinaryWriter writer(materialsData);
+        const auto& materials = mesh.GetMaterials();
+        writer.Write(static_cast<std::uint32_t>(materials.size()));
+        for(const auto& material : materials)
+        {
+            const auto texPath = texturePaths.find(material.first);
+            const auto texImage = textureImages.find(material.first);
+            const QImage* image = texImage != textureImages.end() ? texImage->second.get() : nullptr;
+
+            writer.Write(static_cast<std::uint32_t>(material.first));
+            writer.WriteString(material.second);
+            writer.WriteString(texPath != texturePaths.end() ? texPath->second : std::string());
+            writer.Write(static_cast<std::uint8_t>(image ? 1u : 0u));
+            if(image)
+            {
+                writer.Write(static_cast<std::int32_t>(image->width()));
+                writer.Write(static_cast<std::int32_t>(image->height()));
+                writer.Write(static_cast<std::int32_t>(image->format()));
+                const QByteArray imageData = qCompress(image->constBits(), image->byteCount(), 9);
+                writer.Write(static_cast<std::uint64_t>(imageData.size()));
+                writer.WriteRaw(imageData.constData(), static_cast<std::size_t>(imageData.size()));
+            }
+        }
     }
+
+    const QByteArray* sections[] = { &settingsData, &meshData, &materialsData };
+    const ESection sectionIds[] = { S_SETTINGS, S_MESH, S_MATERIALS };
+    const std::uint32_t numSections = 3u;
+
+    QByteArray fileData;
+    CBinaryWriter writer(fileData);
+    writer.WriteRaw(g_BinaryMagic, sizeof(g_BinaryMagic));
+    writer.Write(g_BinaryVersion);
+    writer.Write(g_ByteOrderMark);
+    writer.Write(numSections);
+
+    std::uint64_t offset = writer.Size() + numSections * sizeof(SSectionEntry);
+    for(std::uint32_t i=0; i<numSections; ++i)
+    {
+        SSectionEntry entry;
+        entry.id = sectionIds[i];
+        entry.reserved = 0u;
+        entry.offset = offset;
+        entry.size = static_cast<std::uint64_t>(sections[i]->size());
+        writer.Write(entry);
+        offset += entry.size;
+    }
+    for(const QByteArray* section : sections)
+        fileData.append(*section);
+
+    return fileData;
+}
+
+SModelData DeserializeJSON(const QByteArray& fileData, CLoadProgress& progress)
+{
     QJsonParseError jsonError;
-    const QJsonDocument doc(QJsonDocument::fromJson(file.readAll(), &jsonError));
+    const QJsonDocument doc(QJsonDocument::fromJson(fileData, &jsonError));
     if(jsonError.error != QJsonParseError::NoError)
     {
-        QMessageBox::warning(this, "Error", QString("Parse error: ") + jsonError.errorString());
-        return;
+        throw std::runtime_error((QString("Parse error: ") + jsonError.errorString()).toStdString());
     }
-    file.close();
+
+    SModelData data;
 
     const QJsonObject root = doc.object();
     const int version = root["version"].toInt();
@@ -123,24 +230,21 @@ void CMainWindow::LoadFromIVO(const QString& filename)
     {
         case 1:
         {
-            std::unique_ptr<CMesh> newModel(new CMesh());
-            newModel->Deserialize(root["mesh"].toObject());
-
-            m_openedModel = filename;
-
-            m_model = std::move(newModel);
-            SetModelToWindows();
-            ClearTextures();
+            progress.Advance();
+            data.mesh.reset(new CMesh());
+            data.mesh->Deserialize(root["mesh"].toObject());
+            progress.Advance();
 
             std::unordered_map<unsigned, std::string> materials;
             const QJsonArray materialsArray = root["materials"].toArray();
             for(int i=0; i<materialsArray.size(); ++i)
             {
+                progress.Check();
                 const QJsonObject material = materialsArray.at(i).toObject();
                 const auto index = static_cast<unsigned>(material["index"].toInt());
 
                 materials[index] = material["name"].toString().toStdString();
-                m_textures[index] = material["path"].toString().toStdString();
+                data.texturePaths[index] = material["path"].toString().toStdString();
 
                 if(!material["image"].isNull())
                 {
@@ -152,34 +256,192 @@ void CMainWindow::LoadFromIVO(const QString& filename)
                     imageData.append(image["base64CompressedPixelData"].toString());
                     imageData = qUncompress(QByteArray::fromBase64(imageData));
 
-                    m_textureImages[index].reset(new QImage(
-                                                     reinterpret_cast<const uchar*>(imageData.constData()),
-                                                     texWidth,
-                                                     texHeight,
-                                                     static_cast<QImage::Format>(texFormat)));
-                    (*m_textureImages[index]) = m_textureImages[index]->copy();
-
-                    emit UpdateTexture(m_textureImages[index].get(), index);
+                    std::unique_ptr<QImage>& texImage = data.textureImages[index];
+                    texImage.reset(new QImage(
+                                       reinterpret_cast<const uchar*>(imageData.constData()),
+                                       texWidth,
+                                       texHeight,
+                                       static_cast<QImage::Format>(texFormat)));
+                    (*texImage) = texImage->copy();
                 }
 
             }
-            m_model->SetMaterials(materials);
-
-            CSettings& sett = CSettings::GetInstance();
-            sett.SetRenderFlags(root["renderFlags"].toInt());
-            sett.SetPaperWidth(root["paperWidth"].toInt());
-            sett.SetPaperHeight(root["paperHeight"].toInt());
-            sett.SetMarginsHorizontal(root["marginsH"].toInt());
-            sett.SetMarginsVertical(root["marginsV"].toInt());
-            sett.SetResolutionScale(root["resolutionScale"].toDouble());
-            sett.SetImageFormat(static_cast<CSettings::ImageFormat>(root["imageFormat"].toInt()));
-            sett.SetImageQuality(root["imageQuality"].toInt());
-            sett.SetLineWidth(root["lineWidth"].toDouble());
-            sett.SetStippleLoop(root["stippleLoop"].toInt());
-            sett.SetFoldMaxFlatAngle(root["maxFlatAngle"].toInt());
+            data.mesh->SetMaterials(materials);
+
+            data.settings.reset(new SStoredSettings());
+            SStoredSettings& sett = *data.settings;
+            sett.renderFlags = root["renderFlags"].toInt();
+            sett.paperWidth = root["paperWidth"].toInt();
+            sett.paperHeight = root["paperHeight"].toInt();
+            sett.marginsHorizontal = root["marginsH"].toInt();
+            sett.marginsVertical = root["marginsV"].toInt();
+            sett.resolutionScale = root["resolutionScale"].toDouble();
+            sett.imageFormat = root["imageFormat"].toInt();
+            sett.imageQuality = root["imageQuality"].toInt();
+            sett.lineWidth = root["lineWidth"].toDouble();
+            sett.stippleLoop = root["stippleLoop"].toInt();
+            sett.foldMaxFlatAngle = root["maxFlatAngle"].toInt();
             break;
         }
         default :
-            QMessageBox::information(this, "Error", "Ivo format version " + QString::number(version) + " is not supported by this version of program!");
+            throw std::runtime_error(("Ivo format version " + QString::number(version) + " is not supported by this version of program!").toStdString());
     }
+
+    return data;
+}
+
+SModelData DeserializeBinary(const uchar* fileData, std::size_t fileSize, CLoadProgress& progress)
+{
+    CBinaryReader header(fileData, fileSize);
+    header.ReadRaw(sizeof(g_BinaryMagic));
+    const std::uint32_t version = header.Read<std::uint32_t>();
+    if(version != g_BinaryVersion)
+        throw std::runtime_error(("Ivo format version " + QString::number(version) + " is not supported by this version of program!").toStdString());
+    if(header.Read<std::uint32_t>() != g_ByteOrderMark)
+        throw std::runtime_error("File was saved on a platform with different byte order!");
+
+    const unsigned char* sections[S_MATERIALS + 1] = {};
+    std::size_t sectionSizes[S_MATERIALS + 1] = {};
+    const std::uint32_t numSections = header.Read<std::uint32_t>();
+    for(std::uint32_t i=0; i<numSections; ++i)
+    {
+        const SSectionEntry entry = header.Read<SSectionEntry>();
+        if(entry.offset > fileSize || entry.size > fileSize - entry.offset)
+            throw std::runtime_error("File corrupted: section is out of file bounds!");
+        //unknown sections are skipped, so that newer files stay readable
+        if(entry.id >= S_SETTINGS && entry.id <= S_MATERIALS)
+        {
+            sections[entry.id] = fileData + entry.offset;
+            sectionSizes[entry.id] = static_cast<std::size_t>(entry.size);
+        }
+    }
+    for(std::uint32_t id=S_SETTINGS; id<=S_MATERIALS; ++id)
+        if(!sections[id])
+            throw std::runtime_error("File corrupted: required section is missing!");
+
+    progress.Advance();
+    SModelData data;
+    data.mesh.reset(new CMesh());
+    {
+        CBinaryReader reader(sections[S_MESH], sectionSizes[S_MESH]);
+        data.mesh->Deserialize(reader);
+    }
+    progress.Advance();
+    {
+        CBinaryReader reader(sections[S_MATERIALS], sectionSizes[S_MATERIALS]);
+        std::unordered_map<unsigned, std::string> materials;
+        const std::uint32_t numMaterials = reader.Read<std::uint32_t>();
+        for(std::uint32_t i=0; i<numMaterials; ++i)
+        {
+            progress.Check();
+            const unsigned index = reader.Read<std::uint32_t>();
+            materials[index] = reader.ReadString();
+            data.texturePaths[index] = reader.ReadString();
+
+            if(reader.Read<std::uint8_t>() != 0u)
+            {
+                const int texWidth = reader.Read<std::int32_t>();
+                const int texHeight = reader.Read<std::int32_t>();
+                const int texFormat = reader.Read<std::int32_t>();
+                const std::uint64_t compressedSize = reader.Read<std::uint64_t>();
+                if(compressedSize > reader.Remaining() || compressedSize > static_cast<std::uint64_t>(INT_MAX))
+                    throw std::runtime_error("File corrupted: texture data is incorrect!");
+                const uchar* compressed = reader.ReadRaw(static_cast<std::size_t>(compressedSize));
+
+                std::unique_ptr<QImage>& texImage = data.textureImages[index];
+                texImage.reset(new QImage(texWidth, texHeight, static_cast<QImage::Format>(texFormat)));
+                const QByteArray imageData = qUncompress(compressed, static_cast<int>(compressedSize));
+                if(texImage->isNull() || imageData.size() != texImage->byteCount())
+                    throw std::runtime_error("File corrupted: texture data is incorrect!");
+                std::memcpy(texImage->bits(), imageData.constData(), static_cast<std::size_t>(imageData.size()));
+            }
+        }
+        data.mesh->SetMaterials(materials);
+    }
+    {
+        CBinaryReader reader(sections[S_SETTINGS], sectionSizes[S_SETTINGS]);
+        data.settings.reset(new SStoredSettings());
+        SStoredSettings& sett = *data.settings;
+        sett.renderFlags = reader.Read<std::uint8_t>();
+        sett.paperWidth = reader.Read<std::uint32_t>();
+        sett.paperHeight = reader.Read<std::uint32_t>();
+        sett.marginsHorizontal = reader.Read<std::uint32_t>();
+        sett.marginsVertical = reader.Read<std::uint32_t>();
+        sett.resolutionScale = reader.Read<float>();
+        sett.imageFormat = static_cast<int>(reader.Read<std::uint32_t>());
+        sett.imageQuality = reader.Read<std::uint8_t>();
+        sett.lineWidth = reader.Read<float>();
+        sett.stippleLoop = reader.Read<std::uint32_t>();
+        sett.foldMaxFlatAngle = reader.Read<std::uint8_t>();
+    }
+
+    return data;
 }
+}
+
+namespace IvoLoader
+{
+
+void SaveToIVO(const QString&                                                  filename,
+               const CMesh&                                                    mesh,
+               const std::unordered_map<unsigned, std::string>&                texturePaths,
+               const std::unordered_map<unsigned, std::unique_ptr<QImage>>&    textureImages,
+               EFormat                                                         format)
+{
+    WriteToFile(filename, format == F_JSON ?
+                          SerializeJSON(mesh, texturePaths, textureImages) :
+                          SerializeBinary(mesh, texturePaths, textureImages));
+}
+
+SModelData LoadFromIVO(const QString& filename, CLoadProgress* progress)
+{
+    CLoadProgress noProgress;
+    CLoadProgress& prog = progress ? *progress : noProgress;
+    //parsing, mesh and materials; adjacency and groups are stored in file
+    prog.BeginStage(CLoadProgress::S_READ, 3);
+
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        throw std::runtime_error((QString("Failed to open '") + filename + "' for reading.").toStdString());
+    }
+
+    //binary files are parsed right from mapped memory; fall back to reading if mapping is not possible
+    QByteArray readData;
+    std::size_t dataSize = static_cast<std::size_t>(file.size());
+    const uchar* fileData = dataSize > 0 ? file.map(0, file.size()) : nullptr;
+    if(!fileData)
+    {
+        readData = file.readAll();
+        fileData = reinterpret_cast<const uchar*>(readData.constData());
+        dataSize = static_cast<std::size_t>(readData.size());
+    }
+
+    SModelData data = dataSize >= sizeof(g_BinaryMagic) && std::memcmp(fileData, g_BinaryMagic, sizeof(g_BinaryMagic)) == 0 ?
+                      DeserializeBinary(fileData, dataSize, prog) :
+                      DeserializeJSON(QByteArray::fromRawData(reinterpret_cast<const char*>(fileData), static_cast<int>(dataSize)), prog);
+    prog.Advance();
+    return data;
+}
+
+void ApplyStoredSettings(const SModelData& data)
+{
+    if(!data.settings)
+        return;
+
+    const SStoredSettings& stored = *data.settings;
+    CSettings& sett = CSettings::GetInstance();
+    sett.SetRenderFlags(stored.renderFlags);
+    sett.SetPaperWidth(stored.paperWidth);
+    sett.SetPaperHeight(stored.paperHeight);
+    sett.SetMarginsHorizontal(stored.marginsHorizontal);
+    sett.SetMarginsVertical(stored.marginsVertical);
+    sett.SetResolutionScale(stored.resolutionScale);
+    sett.SetImageFormat(static_cast<CSettings::ImageFormat>(stored.imageFormat));
+    sett.SetImageQuality(stored.imageQuality);
+    sett.SetLineWidth(stored.lineWidth);
+    sett.SetStippleLoop(stored.stippleLoop);
+    sett.SetFoldMaxFlatAngle(stored.foldMaxFlatAngle);
+}
+
+}//namespace IvoLoader
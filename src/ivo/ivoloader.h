@@ -0,0 +1,44 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef IVOLOADER_H
+#define IVOLOADER_H
+#include <QString>
+#include "io/modeldata.h"
+
+class CLoadProgress;
+
+namespace IvoLoader
+{
+enum EFormat
+{
+    F_BINARY,
+    F_JSON //human readable, understood by older versions
+};
+
+extern void         SaveToIVO(const QString&                                                  filename,
+                              const CMesh&                                                    mesh,
+                              const std::unordered_map<unsigned, std::string>&                texturePaths,
+                              const std::unordered_map<unsigned, std::unique_ptr<QImage>>&    textureImages,
+                              EFormat                                                         format = F_BINARY);
+//format is detected from file contents; safe to call from worker thread
+extern SModelData   LoadFromIVO(const QString& filename, CLoadProgress* progress = nullptr);
+//copies settings stored in loaded file to CSettings, which notifies subscribers
+extern void         ApplyStoredSettings(const SModelData& data);
+}
+
+#endif // IVOLOADER_H
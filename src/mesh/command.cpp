@@ -59,7 +59,7 @@ void CAtomicCommand::Redo() const
 
     CMesh::STriangle2D* tr = m_triangle;
     CMesh::STriGroup* grp = tr->GetGroup();
-    CMesh* msh = CMesh::GetMesh();
+    CMesh* msh = grp->m_mesh;
 
     switch(m_type)
     {
@@ -83,14 +83,14 @@ void CAtomicCommand::Redo() const
         {
             if(m_edge < 0 || m_edge > 2) return;
 
-            tr->GetEdge(m_edge)->SetSnapped(true);
+            msh->SetEdgeSnapped(*tr->GetEdge(m_edge), true);
             break;
         }
         case CT_BREAK_EDGE :
         {
             if(m_edge < 0 || m_edge > 2) return;
 
-            tr->GetEdge(m_edge)->SetSnapped(false);
+            msh->SetEdgeSnapped(*tr->GetEdge(m_edge), false);
             break;
         }
         case CT_JOIN_GROUPS :
@@ -117,7 +117,7 @@ void CAtomicCommand::Undo() const
 
     CMesh::STriangle2D* tr = m_triangle;
     CMesh::STriGroup* grp = tr->GetGroup();
-    CMesh* msh = CMesh::GetMesh();
+    CMesh* msh = grp->m_mesh;
 
     switch(m_type)
     {
@@ -141,14 +141,14 @@ void CAtomicCommand::Undo() const
         {
             if(m_edge < 0 || m_edge > 2) return;
 
-            tr->GetEdge(m_edge)->SetSnapped(false);
+            msh->SetEdgeSnapped(*tr->GetEdge(m_edge), false);
             break;
         }
         case CT_BREAK_EDGE :
         {
             if(m_edge < 0 || m_edge > 2) return;
 
-            tr->GetEdge(m_edge)->SetSnapped(true);
+            msh->SetEdgeSnapped(*tr->GetEdge(m_edge), true);
             break;
         }
         case CT_JOIN_GROUPS :
@@ -180,6 +180,11 @@ void CIvoCommand::AddAction(CIvoCommand&& cmd)
     cmd.m_actions.clear();
 }
 
+std::size_t CIvoCommand::GetMemoryUsage() const
+{
+    return sizeof(*this) + m_actions.capacity() * sizeof(CAtomicCommand);
+}
+
 void CIvoCommand::undo()
 {
     for(auto it = m_actions.rbegin(); it != m_actions.rend(); ++it)
@@ -195,3 +200,31 @@ void CIvoCommand::redo()
         (*it).Redo();
     }
 }
+
+void CTransformCommand::AddGroup(CMesh::STriGroup* grp, const glm::vec2& oldPosition, float oldRotation, const glm::vec2& newPosition, float newRotation)
+{
+    m_transforms.push_back(SGroupTransform{grp->GetTriangles().front(), newPosition - oldPosition, newRotation - oldRotation});
+}
+
+std::size_t CTransformCommand::GetMemoryUsage() const
+{
+    return sizeof(*this) + m_transforms.capacity() * sizeof(SGroupTransform);
+}
+
+void CTransformCommand::undo()
+{
+    for(auto it = m_transforms.rbegin(); it != m_transforms.rend(); ++it)
+    {
+        CMesh::STriGroup* grp = it->triangle->GetGroup();
+        grp->SetTransform(grp->GetPosition() - it->translation, grp->GetRotation() - it->rotation);
+    }
+}
+
+void CTransformCommand::redo()
+{
+    for(const SGroupTransform& transform : m_transforms)
+    {
+        CMesh::STriGroup* grp = transform.triangle->GetGroup();
+        grp->SetTransform(grp->GetPosition() + transform.translation, grp->GetRotation() + transform.rotation);
+    }
+}
@@ -17,9 +17,9 @@
 */
 #ifndef IVO_COMMAND_H
 #define IVO_COMMAND_H
-#include <QUndoCommand>
 #include <glm/vec2.hpp>
-#include <list>
+#include <vector>
+#include <cstddef>
 #include "mesh.h"
 
 enum ECommandType
@@ -56,7 +56,18 @@ private:
     ECommandType        m_type;
 };
 
-class CIvoCommand : public QUndoCommand
+//command of mesh's undo stack; reports memory it holds, so history can be limited by size
+class IMeshCommand
+{
+public:
+    virtual ~IMeshCommand() = default;
+
+    virtual void undo() = 0;
+    virtual void redo() = 0;
+    virtual std::size_t GetMemoryUsage() const = 0;
+};
+
+class CIvoCommand : public IMeshCommand
 {
 public:
     void AddAction(const CAtomicCommand& action);
@@ -64,9 +75,32 @@ public:
 
     virtual void undo() override;
     virtual void redo() override;
+    virtual std::size_t GetMemoryUsage() const override;
 
 private:
-    std::list<CAtomicCommand> m_actions;
+    std::vector<CAtomicCommand> m_actions;
+};
+
+//moves and rotates many groups at once; every group is transformed exactly once per undo/redo
+class CTransformCommand : public IMeshCommand
+{
+public:
+    void AddGroup(CMesh::STriGroup* grp, const glm::vec2& oldPosition, float oldRotation, const glm::vec2& newPosition, float newRotation);
+    bool IsEmpty() const { return m_transforms.empty(); }
+
+    virtual void undo() override;
+    virtual void redo() override;
+    virtual std::size_t GetMemoryUsage() const override;
+
+private:
+    struct SGroupTransform
+    {
+        CMesh::STriangle2D* triangle; //groups are found by triangle, like in CAtomicCommand
+        glm::vec2           translation;
+        float               rotation;
+    };
+
+    std::vector<SGroupTransform> m_transforms;
 };
 
 #endif // IVO_COMMAND_H
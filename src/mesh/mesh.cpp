@@ -29,6 +29,7 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <assimp/mesh.h>
+#include <assimp/ProgressHandler.hpp>
 #include <QObject>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -36,6 +37,8 @@
 #include "mesh/command.h"
 #include "settings/settings.h"
 #include "io/utils.h"
+#include "io/binaryio.h"
+#include "io/loadprogress.h"
 #include "notification/hub.h"
 #include "geometric/compgeom.h"
 
@@ -60,14 +63,171 @@ using glm::angleBetween;
 
 extern const int IVO_VERSION = 1;
 
-CMesh* CMesh::g_Mesh = nullptr;
+namespace
+{
+//directed edge of a 3D triangle together with normals at its ends
+struct SHalfEdgeKey
+{
+    vec3 v0, v1;
+    vec3 n0, n1;
+
+    bool operator==(const SHalfEdgeKey& other) const
+    {
+        return v0 == other.v0 && v1 == other.v1 &&
+               n0 == other.n0 && n1 == other.n1;
+    }
+};
+
+struct SHalfEdgeHash
+{
+    std::size_t operator()(const SHalfEdgeKey& key) const
+    {
+        std::size_t seed = 0;
+        Combine(seed, key.v0);
+        Combine(seed, key.v1);
+        Combine(seed, key.n0);
+        Combine(seed, key.n1);
+        return seed;
+    }
+
+private:
+    static void Combine(std::size_t& seed, const vec3& v)
+    {
+        for(int i=0; i<3; ++i)
+        {
+            //+0.0 and -0.0 are equal, so they must have equal hashes too
+            const float val = (v[i] == 0.0f ? 0.0f : v[i]);
+            seed ^= std::hash<float>()(val) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+    }
+};
 
-CMesh::CMesh()
+//Frontier of triangles waiting to be unfolded, ordered by the dihedral angle of
+//the edge they were reached through. Among equal angles the triangle pushed last
+//goes first. Pushing a triangle again drops its nearest queued entry that would
+//be popped after the new one (lazy deletion)
+class CUnfoldFrontier
 {
-    m_undoStack.setUndoLimit(100);
+public:
+    struct SCandidate
+    {
+        std::size_t tri;
+        int         referal;
+    };
+
+    bool Empty() const
+    {
+        return m_heap.empty();
+    }
+
+    void Push(std::size_t tri, int referal, float angle)
+    {
+        std::vector<std::size_t>& queued = m_queued[tri];
+        auto superseded = queued.end();
+        for(auto it = queued.begin(); it != queued.end(); ++it)
+        {
+            const SEntry& e = m_entries[*it];
+            if(e.angle >= angle && (superseded == queued.end() || PoppedBefore(*it, *superseded)))
+                superseded = it;
+        }
+        if(superseded != queued.end())
+        {
+            m_entries[*superseded].removed = true;
+            queued.erase(superseded);
+        }
+
+        queued.push_back(m_entries.size());
+        m_entries.push_back({ tri, referal, angle, false });
+        m_heap.push_back(m_entries.size() - 1);
+        std::push_heap(m_heap.begin(), m_heap.end(), HeapCompare(*this));
+        DropRemoved();
+    }
 
-    QObject::connect(&m_undoStack, &QUndoStack::canRedoChanged, [this](){ NOTIFY(UndoRedoChanged); });
-    QObject::connect(&m_undoStack, &QUndoStack::canUndoChanged, [this](){ NOTIFY(UndoRedoChanged); });
+    SCandidate Pop()
+    {
+        assert(!Empty());
+        std::pop_heap(m_heap.begin(), m_heap.end(), HeapCompare(*this));
+        const std::size_t top = m_heap.back();
+        m_heap.pop_back();
+
+        SEntry& e = m_entries[top];
+        e.removed = true;
+        std::vector<std::size_t>& queued = m_queued[e.tri];
+        queued.erase(std::find(queued.begin(), queued.end(), top));
+
+        SCandidate c = { e.tri, e.referal };
+        DropRemoved();
+        return c;
+    }
+
+private:
+    struct SEntry
+    {
+        std::size_t tri;
+        int         referal;
+        float       angle;
+        bool        removed;
+    };
+
+    struct HeapCompare
+    {
+        explicit HeapCompare(const CUnfoldFrontier& frontier) : m_frontier(frontier) {}
+        bool operator()(std::size_t a, std::size_t b) const { return m_frontier.PoppedBefore(b, a); }
+        const CUnfoldFrontier& m_frontier;
+    };
+
+    //entry indices grow with every push, so they double as insertion order
+    bool PoppedBefore(std::size_t a, std::size_t b) const
+    {
+        const float angleA = m_entries[a].angle;
+        const float angleB = m_entries[b].angle;
+        return angleA != angleB ? angleA < angleB : a > b;
+    }
+
+    void DropRemoved()
+    {
+        while(!m_heap.empty() && m_entries[m_heap.front()].removed)
+        {
+            std::pop_heap(m_heap.begin(), m_heap.end(), HeapCompare(*this));
+            m_heap.pop_back();
+        }
+    }
+
+    std::vector<SEntry>                                        m_entries;
+    std::vector<std::size_t>                                   m_heap;
+    std::unordered_map<std::size_t, std::vector<std::size_t>> m_queued;
+};
+
+
+//forwards reading progress of assimp and aborts reading once import is cancelled
+class CImportProgressHandler : public Assimp::ProgressHandler
+{
+public:
+    explicit CImportProgressHandler(CLoadProgress& progress) : m_progress(progress) {}
+
+    bool Update(float percentage) override
+    {
+        if(percentage >= 0.0f)
+            m_progress.SetDone(static_cast<std::size_t>(percentage * 100.0f));
+        return !m_progress.IsCancelled();
+    }
+
+private:
+    CLoadProgress& m_progress;
+};
+} //namespace anonymous
+
+constexpr std::uint32_t CMesh::NO_INDEX;
+
+CMesh::CMesh() :
+    m_groupTree(1.0f),
+    m_depthCapacity(0),
+    m_nextDepthSlot(1),
+    m_depthStep(1.0f),
+    m_geometryRevision(1),
+    m_pickRevision(1),
+    m_undoStack([this](){ NOTIFY(UndoRedoChanged); })
+{
 }
 
 CMesh::~CMesh()
@@ -76,26 +236,30 @@ CMesh::~CMesh()
 
 void CMesh::Clear()
 {
-    m_undoStack.clear();
+    m_undoStack.Clear();
     m_vertices.clear();
     m_normals.clear();
     m_uvCoords.clear();
     m_triangles.clear();
     m_flatNormals.clear();
     m_tri2D.clear();
+    m_edges.clear();
     m_groups.clear();
     m_materials.clear();
     ClearPickedTriangles();
+    ++m_geometryRevision;
 }
 
 void CMesh::ClearPickedTriangles()
 {
     m_pickTriIndices.clear();
+    ++m_pickRevision;
 }
 
 void CMesh::SetTriangleAsPicked(std::size_t index)
 {
-    m_pickTriIndices.insert(index);
+    if(m_pickTriIndices.insert(index).second)
+        ++m_pickRevision;
 }
 
 void CMesh::SetTriangleAsUnpicked(std::size_t index)
@@ -104,6 +268,7 @@ void CMesh::SetTriangleAsUnpicked(std::size_t index)
     if(foundPos != m_pickTriIndices.end())
     {
         m_pickTriIndices.erase(foundPos);
+        ++m_pickRevision;
     }
 }
 
@@ -112,9 +277,8 @@ bool CMesh::IsTrianglePicked(std::size_t index) const
     return m_pickTriIndices.find(index) != m_pickTriIndices.end();
 }
 
-void CMesh::AddMeshesFromAIScene(const aiScene* scene, const aiNode* node)
+void CMesh::AddMeshesFromAIScene(const aiScene* scene, const aiNode* node, unsigned& unnamedMatIndex)
 {
-    static unsigned unnamedMatIndex = 1u;
     for(unsigned n=0; n<node->mNumMeshes; ++n)
     {
         const aiMesh* mesh = scene->mMeshes[node->mMeshes[n]];
@@ -172,16 +336,20 @@ void CMesh::AddMeshesFromAIScene(const aiScene* scene, const aiNode* node)
 
     for(unsigned n=0; n<node->mNumChildren; ++n)
     {
-        AddMeshesFromAIScene(scene, node->mChildren[n]);
+        AddMeshesFromAIScene(scene, node->mChildren[n], unnamedMatIndex);
     }
-    unnamedMatIndex = 1u;
 }
 
-void CMesh::LoadMesh(const std::string& path)
+void CMesh::LoadMesh(const std::string& path, CLoadProgress* progress)
 {
+    CLoadProgress noProgress;
+    CLoadProgress& prog = progress ? *progress : noProgress;
+
     Clear();
 
+    prog.BeginStage(CLoadProgress::S_READ, 100);
     Assimp::Importer importer;
+    importer.SetProgressHandler(new CImportProgressHandler(prog)); //importer takes ownership
 
     const aiScene* scene = importer.ReadFile(path,   aiProcess_JoinIdenticalVertices |
                                                      aiProcess_Triangulate |
@@ -191,10 +359,12 @@ void CMesh::LoadMesh(const std::string& path)
                                                      aiProcess_FlipUVs);
     if(!scene)
     {
+        prog.Check();
         throw std::logic_error(importer.GetErrorString());
     }
 
-    AddMeshesFromAIScene(scene, scene->mRootNode);
+    unsigned unnamedMatIndex = 1u;
+    AddMeshesFromAIScene(scene, scene->mRootNode, unnamedMatIndex);
 
     if(m_vertices.size() == 0)
     {
@@ -202,18 +372,21 @@ void CMesh::LoadMesh(const std::string& path)
     }
 
     CalculateFlatNormals(); //this function goes first!
-    FillAdjTri_Gen2DTri();
-    GroupTriangles((float)CSettings::GetInstance().GetDetachAngle());
-    PackGroups(false);
+    FillAdjTri_Gen2DTri(prog);
+    GroupTriangles((float)CSettings::GetInstance().GetDetachAngle(), prog);
+    PackGroups(false, &prog);
     CalculateAABBox();
-    g_Mesh = this;
 }
 
 void CMesh::LoadFromPDO(const std::vector<PDO_Face>&                  faces,
                         const std::vector<std::unique_ptr<PDO_Edge>>& edges,
                         const std::vector<vec3>&                      vertices3D,
-                        const std::unordered_map<unsigned, PDO_Part>& parts)
+                        const std::unordered_map<unsigned, PDO_Part>& parts,
+                        CLoadProgress*                                progress)
 {
+    CLoadProgress noProgress;
+    CLoadProgress& prog = progress ? *progress : noProgress;
+
     Clear();
 
     m_tri2D.resize(faces.size());
@@ -251,7 +424,7 @@ void CMesh::LoadFromPDO(const std::vector<PDO_Face>&                  faces,
         tr2D.m_relativeMx = mat3(1);
         for(int i=0; i<3; i++)
         {
-            tr2D.m_edges[i] = nullptr;
+            tr2D.m_edges[i] = NO_INDEX;
             tr2D.m_flapSharp[i] = false;
             tr2D.m_vtx[i] = tr2D.m_vtxR[i] = face.vertices[i].pos - averageTri2DPos;
             tr2D.m_vtxRT[i] = face.vertices[i].pos;
@@ -269,14 +442,17 @@ void CMesh::LoadFromPDO(const std::vector<PDO_Face>&                  faces,
 
     CalculateFlatNormals();
 
+    prog.BeginStage(CLoadProgress::S_ADJACENCY, edges.size());
+    m_edges.reserve(edges.size());
     for(const std::unique_ptr<PDO_Edge>& e : edges)
     {
+        prog.Advance();
         const PDO_Edge& edge = *e;
 
         m_edges.emplace_back();
         SEdge &edg = m_edges.back();
 
-        edg.m_left = &m_tri2D[edge.face1ID];
+        edg.m_left = static_cast<std::uint32_t>(edge.face1ID);
         for(int i=0; i<3; i++)
         {
             if(edge.vtx1ID == faces[edge.face1ID].vertices[i].index3Dvert)
@@ -285,11 +461,10 @@ void CMesh::LoadFromPDO(const std::vector<PDO_Face>&                  faces,
                 break;
             }
         }
-        edg.m_left->m_edges[edg.m_leftIndex] = &edg;
 
         if(edge.face2ID >= 0)
         {
-            edg.m_right = &m_tri2D[edge.face2ID];
+            edg.m_right = static_cast<std::uint32_t>(edge.face2ID);
             for(int i=0; i<3; i++)
             {
                 if(edge.vtx2ID == faces[edge.face2ID].vertices[i].index3Dvert)
@@ -298,7 +473,6 @@ void CMesh::LoadFromPDO(const std::vector<PDO_Face>&                  faces,
                     break;
                 }
             }
-            edg.m_right->m_edges[edg.m_rightIndex] = &edg;
             edg.m_angle = degrees(acos(clamp(dot(m_flatNormals[edge.face1ID], m_flatNormals[edge.face2ID]), -1.0f, 1.0f)));
 
             const PDO_2DVertex& v1 = faces[edge.face1ID].vertices[edg.m_leftIndex];
@@ -307,7 +481,7 @@ void CMesh::LoadFromPDO(const std::vector<PDO_Face>&                  faces,
         }
         else
         {
-            edg.m_right = nullptr;
+            edg.m_right = NO_INDEX;
             edg.m_rightIndex = -1;
             edg.m_angle = 0.0f;
             edg.m_flapPosition = SEdge::FP_NONE;
@@ -316,16 +490,18 @@ void CMesh::LoadFromPDO(const std::vector<PDO_Face>&                  faces,
         edg.m_snapped = edge.snapped;
         SetFoldType(edg);
     }
+    LinkEdges();
 
+    prog.BeginStage(CLoadProgress::S_GROUPING, parts.size());
     for(auto it=parts.begin(); it!=parts.end(); it++)
     {
+        prog.Advance();
         const PDO_Part& part = it->second;
-        m_groups.emplace_back();
-        STriGroup& grp = m_groups.back();
+        STriGroup& grp = CreateGroup();
 
         for(const PDO_Face* fc : part.faces)
         {
-            grp.m_tris.push_back(&m_tri2D[fc->id]);
+            grp.m_tris.push_back(static_cast<std::uint32_t>(fc->id));
             m_tri2D[fc->id].m_myGroup = &grp;
         }
 
@@ -334,18 +510,39 @@ void CMesh::LoadFromPDO(const std::vector<PDO_Face>&                  faces,
     }
 
     UpdateGroupDepth();
+    AttachGroupsToScene();
     CalculateAABBox();
-    g_Mesh = this;
 }
 
-void CMesh::FillAdjTri_Gen2DTri()
+void CMesh::FillAdjTri_Gen2DTri(CLoadProgress& progress)
 {
+    progress.BeginStage(CLoadProgress::S_ADJACENCY, m_triangles.size());
+
     STriangle2D dummy;
-    for(int i=0; i<3; ++i) dummy.m_edges[i] = nullptr;
+    for(int i=0; i<3; ++i) dummy.m_edges[i] = NO_INDEX;
     m_tri2D.resize(m_triangles.size(), dummy);
 
+    //every half-edge of every triangle, keyed by its vertices and normals;
+    //candidates are sorted by triangle index ascending and, within a triangle,
+    //by edge index descending, so that back() is always the best match
+    std::unordered_map<SHalfEdgeKey, std::vector<std::pair<std::size_t, int>>, SHalfEdgeHash> halfEdges;
+    halfEdges.reserve(m_triangles.size()*3);
+    //sides of triangles that already have an edge; triangles are linked to them once all edges exist
+    std::vector<char> hasEdge(m_triangles.size()*3, 0);
+    m_edges.reserve(m_triangles.size()*3/2 + 1);
+    for(std::size_t j=0; j<m_triangles.size(); ++j)
+    {
+        const uvec4 &t = m_triangles[j];
+        for(int e=3; e-- > 0;)
+        {
+            const int e2 = (e+1)%3;
+            halfEdges[{ m_vertices[t[e]], m_vertices[t[e2]], m_normals[t[e]], m_normals[t[e2]] }].emplace_back(j, e);
+        }
+    }
+
     for(std::size_t i = m_triangles.size(); i-- > 0;)
     {
+        progress.Advance();
         const uvec4 &t = m_triangles[i];
         const vec3* v1[3] = { &m_vertices[t[0]], &m_vertices[t[1]], &m_vertices[t[2]] };
         const vec3* n1[3] = { &m_normals[t[0]],  &m_normals[t[1]],  &m_normals[t[2]] };
@@ -362,40 +559,60 @@ void CMesh::FillAdjTri_Gen2DTri()
         m_tri2D[i].Init();
         m_tri2D[i].m_id = i;
 
-        for(std::size_t j = m_triangles.size(); j-- > 0;)
+        //triangle i is adjacent to the triangle j with the largest index below i that
+        //has a free half-edge going in the opposite direction (same vertices and normals).
+        //Triangles above i have all their edges assigned already, so they are dropped
+        struct { std::size_t tri; int e1; int e2; } adjacent[3];
+        int adjCount = 0;
+        for(int e1=0; e1<3; ++e1)
         {
-            if(j == i) //triangle cannot be adjacent to itself :P
+            if(hasEdge[i*3 + e1])
                 continue;
 
-            if(m_tri2D[i].m_edges[0] != nullptr &&
-               m_tri2D[i].m_edges[1] != nullptr &&
-               m_tri2D[i].m_edges[2] != nullptr)
-                break;
+            const int e1n = (e1+1)%3;
+            auto it = halfEdges.find({ *v1[e1n], *v1[e1], *n1[e1n], *n1[e1] });
+            if(it == halfEdges.end())
+                continue;
+
+            auto& candidates = it->second;
+            while(!candidates.empty() &&
+                  (candidates.back().first >= i || //triangle cannot be adjacent to itself :P
+                   hasEdge[candidates.back().first*3 + candidates.back().second]))
+                candidates.pop_back();
+
+            if(!candidates.empty())
+            {
+                adjacent[adjCount].tri = candidates.back().first;
+                adjacent[adjCount].e1 = e1;
+                adjacent[adjCount].e2 = candidates.back().second;
+                adjCount++;
+            }
+        }
+
+        //create edges in the same order as pairwise scan of triangles did
+        std::sort(adjacent, adjacent + adjCount, [](const decltype(adjacent[0])& a, const decltype(adjacent[0])& b)
+        {
+            return a.tri != b.tri ? a.tri > b.tri : a.e1 < b.e1;
+        });
 
-            const uvec4 &t2 = m_triangles[j];
-            const vec3* v2[3] = { &m_vertices[t2[0]], &m_vertices[t2[1]], &m_vertices[t2[2]] };
-            const vec3* n2[3] = { &m_normals[t2[0]], &m_normals[t2[1]], &m_normals[t2[2]] };
-
-            //9 cases edges of 2 triangles can be adjacent:
-            for(int e1=0; e1<3; ++e1)
-                if(m_tri2D[i].m_edges[e1] == nullptr)
-                    for(int e2=0; e2<3; ++e2)
-                        if(*v1[e1] == *v2[(e2+1)%3] && *v1[(e1+1)%3] == *v2[e2] && //vertices and
-                           *n1[e1] == *n2[(e2+1)%3] && *n1[(e1+1)%3] == *n2[e2] && //normals are equal <=> triangles are adjacent
-                           m_tri2D[j].m_edges[e2] == nullptr)
-                            DetermineFoldParams(i, j, e1, e2);
+        for(int a=0; a<adjCount; ++a)
+        {
+            DetermineFoldParams(i, adjacent[a].tri, adjacent[a].e1, adjacent[a].e2);
+            hasEdge[i*3 + adjacent[a].e1] = 1;
+            hasEdge[adjacent[a].tri*3 + adjacent[a].e2] = 1;
         }
+
         for(int j=0; j<3; ++j)
         {
-            if(m_tri2D[i].m_edges[j] == nullptr)
+            if(!hasEdge[i*3 + j])
             {
                 m_edges.emplace_back();
                 SEdge &edg = m_edges.back();
-                m_tri2D[i].m_edges[j] = &edg;
-                edg.m_left = &m_tri2D[i];
+                hasEdge[i*3 + j] = 1;
+                edg.m_left = static_cast<std::uint32_t>(i);
                 edg.m_leftIndex = j;
                 edg.m_rightIndex = -1;
-                edg.m_right = nullptr;
+                edg.m_right = NO_INDEX;
                 edg.m_angle = 0.0f;
                 edg.m_snapped = false;
                 edg.m_foldType = SEdge::FT_FLAT;
@@ -403,6 +620,8 @@ void CMesh::FillAdjTri_Gen2DTri()
             }
         }
     }
+    m_edges.shrink_to_fit();
+    LinkEdges();
 }
 
 void CMesh::SetFoldType(SEdge &edg)
@@ -413,8 +632,8 @@ void CMesh::SetFoldType(SEdge &edg)
         return;
     }
 
-    std::size_t i = edg.m_left->m_id;
-    std::size_t j = edg.m_right->m_id;
+    std::size_t i = m_tri2D[edg.m_left].m_id;
+    std::size_t j = m_tri2D[edg.m_right].m_id;
     vec3 &v0 = m_vertices[m_triangles[i][0]];
     vec3 &v1 = m_vertices[m_triangles[i][1]];
     vec3 &up = m_flatNormals[i];
@@ -462,14 +681,12 @@ void CMesh::DetermineFoldParams(std::size_t i, std::size_t j, int e1, int e2)
 {
     m_edges.emplace_back();
     SEdge &edg = m_edges.back();
-    edg.m_left = &m_tri2D[i];
-    edg.m_right = &m_tri2D[j];
+    edg.m_left = static_cast<std::uint32_t>(i);
+    edg.m_right = static_cast<std::uint32_t>(j);
     edg.m_leftIndex = e1;
     edg.m_rightIndex = e2;
     edg.m_snapped = false;
     edg.m_flapPosition = SEdge::FP_LEFT;
-    m_tri2D[i].m_edges[e1] = &edg;
-    m_tri2D[j].m_edges[e2] = &edg;
 
     float angle = degrees(angleBetween(m_flatNormals[i], m_flatNormals[j]));
     edg.m_angle = angle;
@@ -478,6 +695,32 @@ void CMesh::DetermineFoldParams(std::size_t i, std::size_t j, int e1, int e2)
     SetFoldType(edg);
 }
 
+//fills edge indices of triangles from triangle indices of edges
+void CMesh::LinkEdges()
+{
+    for(std::size_t i=0; i<m_edges.size(); ++i)
+    {
+        const SEdge& e = m_edges[i];
+        if(e.m_left != NO_INDEX)
+            m_tri2D[e.m_left].m_edges[e.m_leftIndex] = static_cast<std::uint32_t>(i);
+        if(e.m_right != NO_INDEX)
+            m_tri2D[e.m_right].m_edges[e.m_rightIndex] = static_cast<std::uint32_t>(i);
+    }
+}
+
+std::uint32_t CMesh::IndexOf(const STriangle2D* tr) const
+{
+    assert(tr >= m_tri2D.data() && tr < m_tri2D.data() + m_tri2D.size());
+    return static_cast<std::uint32_t>(tr - m_tri2D.data());
+}
+
+void CMesh::MarkGroupsModified(const SEdge& edge)
+{
+    for(std::uint32_t tri : { edge.m_left, edge.m_right })
+        if(tri != NO_INDEX && m_tri2D[tri].m_myGroup)
+            m_tri2D[tri].m_myGroup->Modified();
+}
+
 void CMesh::CalculateFlatNormals()
 {
     for(const uvec4 &t : m_triangles)
@@ -491,102 +734,47 @@ void CMesh::CalculateFlatNormals()
     }
 }
 
-void CMesh::GroupTriangles(float maxAngleDeg)
+void CMesh::GroupTriangles(float maxAngleDeg, CLoadProgress& progress)
 {
+    progress.BeginStage(CLoadProgress::S_GROUPING, m_tri2D.size());
     for(std::size_t i=m_tri2D.size(); i-- > 0;)
     {
         if(m_tri2D[i].m_myGroup != nullptr)
             continue;
         //we found first ungrouped triangle! Create new group
-        m_groups.emplace_back();
-        //list of candidates contains triangles that might get in group
-        std::list<std::pair<std::size_t, int>> candidates;
-        candidates.push_front(std::make_pair(i, -1));
-        STriGroup &grp = m_groups.back();
+        STriGroup &grp = CreateGroup();
+        //frontier contains triangles that might get in group
+        CUnfoldFrontier candidates;
+        candidates.Push(i, -1, 0.0f);
 
-        while(!candidates.empty())
+        while(!candidates.Empty())
         {
-            auto& c = candidates.front();
+            const CUnfoldFrontier::SCandidate c = candidates.Pop();
 
             //triangle is added if it does not overlap existing triangles in group
-            if(grp.AddTriangle(&m_tri2D[c.first], (c.second > -1 ? &m_tri2D[c.second] : nullptr)) )
+            if(grp.AddTriangle(&m_tri2D[c.tri], (c.referal > -1 ? &m_tri2D[c.referal] : nullptr)) )
             {
                 //if this triangle is added, then it's neighbours are potential candidates
-                STriangle2D &tr = m_tri2D[c.first];
-                STriangle2D *tr2 = nullptr;
+                const STriangle2D &tr = m_tri2D[c.tri];
                 for(int n=0; n<3; ++n)
                 {
-                    if(!tr.m_edges[n]->HasTwoTriangles())
+                    const SEdge& edge = m_edges[tr.m_edges[n]];
+                    if(!edge.HasTwoTriangles()) //if edge n has no neighbour...
                         continue;
 
-                    tr2 = tr.m_edges[n]->GetOtherTriangle(&tr);
+                    const std::uint32_t tr2 = edge.GetOtherTriangle(static_cast<std::uint32_t>(c.tri));
 
-                    if(tr2) //if edge n has neighbour...
-                    if(tr.m_edges[n]->m_angle <= maxAngleDeg) //angle between neighbour is in valid range
-                    if(tr2->m_myGroup == nullptr) //neighbour is groupless
-                    {
-                        //skip first iterator, because it is to be removed from list
-                        auto itNextLargerAngle = candidates.begin();
-                        itNextLargerAngle++;
-
-                        const float myAngle = tr.m_edges[n]->m_angle;
-
-                        //insertion to 'sorted' list
-                        bool inserted = false;
-                        do
-                        {
-                            float otherAngle = -999.0f;
-
-                            if(itNextLargerAngle != candidates.end())
-                            {
-                                const STriangle2D &othTr = m_tri2D[(*itNextLargerAngle).first];
-
-                                if((*itNextLargerAngle).second > -1)
-                                {
-                                    for(int oInd=0; oInd<3; ++oInd)
-                                    {
-                                        const STriangle2D *othTr2 = othTr.m_edges[oInd]->GetOtherTriangle(&othTr);
-                                        if(othTr2 && othTr2->ID() == (*itNextLargerAngle).second)
-                                        {
-                                            otherAngle = othTr.m_edges[oInd]->m_angle;
-                                            break;
-                                        }
-                                    }
-
-                                    inserted = myAngle <= otherAngle;
-                                }
-                            } else {
-                                inserted = true;
-                            }
-
-                            if(inserted)
-                            {
-                                candidates.insert(itNextLargerAngle, std::make_pair(tr2->m_id, static_cast<int>(c.first)));
-
-                                //remove possible duplicates
-                                while(itNextLargerAngle != candidates.end())
-                                {
-                                    if((*itNextLargerAngle).first == tr2->m_id)
-                                    {
-                                        candidates.erase(itNextLargerAngle);
-                                        break;
-                                    }
-                                    itNextLargerAngle++;
-                                }
-                            } else {
-                                itNextLargerAngle++;
-                            }
-
-                        } while(!inserted);
-                    }
+                    if(edge.m_angle <= maxAngleDeg) //angle between neighbour is in valid range
+                    if(m_tri2D[tr2].m_myGroup == nullptr) //neighbour is groupless
+                        candidates.Push(tr2, static_cast<int>(c.tri), edge.m_angle);
                 }
             }
-            //this candidate has been processed
-            candidates.pop_front();
         }
         grp.CentrateOrigin();
+        progress.Advance(grp.m_tris.size());
     }
     UpdateGroupDepth();
+    AttachGroupsToScene();
 }
 
 void CMesh::GroupPickedTriangles()
@@ -599,7 +787,7 @@ void CMesh::GroupPickedTriangles()
     {
         for(int e=0; e<3; e++)
         {
-            if(m_tri2D[i].m_edges[e]->IsSnapped())
+            if(m_edges[m_tri2D[i].m_edges[e]].IsSnapped())
             {
                 CIvoCommand* breakCmd = m_tri2D[i].m_myGroup->GetBreakEdgeCmd(&m_tri2D[i], e);
                 if(breakCmd)
@@ -619,65 +807,22 @@ void CMesh::GroupPickedTriangles()
     {
         if(processedTris.find(i) != processedTris.end())
             continue;
-        //list of candidates contains triangles that might get in group
-        std::list<std::pair<std::size_t, int>> candidates;
-        candidates.push_front(std::make_pair(i, -1));
+        //frontier contains triangles that might get in group
+        CUnfoldFrontier candidates;
 
         std::function<void(STriangle2D&)> addNeighbours = [this, &processedTris, &candidates](STriangle2D& tr)
         {
-            STriangle2D *tr2 = nullptr;
+            const std::uint32_t trInd = IndexOf(&tr);
             for(int n=0; n<3; ++n)
             {
-                if(!tr.m_edges[n]->HasTwoTriangles())
+                const SEdge& edge = m_edges[tr.m_edges[n]];
+                if(!edge.HasTwoTriangles())
                     continue;
 
-                tr2 = tr.m_edges[n]->GetOtherTriangle(&tr);
-
-                if(tr2)
-                if(m_pickTriIndices.find(tr2->ID()) != m_pickTriIndices.end() && processedTris.find(tr2->ID()) == processedTris.end())
-                {
-                    //skip first iterator, because it is to be removed from list
-                    auto itNextLargerAngle = candidates.begin();
-                    itNextLargerAngle++;
+                const STriangle2D& tr2 = m_tri2D[edge.GetOtherTriangle(trInd)];
 
-                    const float myAngle = tr.m_edges[n]->m_angle;
-
-                    //insertion to 'sorted' list
-                    bool inserted = false;
-                    do
-                    {
-                        if(itNextLargerAngle != candidates.end())
-                        {
-                            const STriangle2D &othTr = m_tri2D[(*itNextLargerAngle).first];
-
-                            if((*itNextLargerAngle).second > -1)
-                            {
-                                inserted = myAngle <= othTr.m_edges[(*itNextLargerAngle).second]->m_angle;
-                            }
-                        } else {
-                            inserted = true;
-                        }
-
-                        if(inserted)
-                        {
-                            candidates.insert(itNextLargerAngle, std::make_pair(tr2->m_id, tr.m_edges[n]->GetOtherTriIndex(&tr)));
-
-                            //remove possible duplicates
-                            while(itNextLargerAngle != candidates.end())
-                            {
-                                if((*itNextLargerAngle).first == tr2->m_id)
-                                {
-                                    candidates.erase(itNextLargerAngle);
-                                    break;
-                                }
-                                itNextLargerAngle++;
-                            }
-                        } else {
-                            itNextLargerAngle++;
-                        }
-
-                    } while(!inserted);
-                }
+                if(m_pickTriIndices.find(tr2.ID()) != m_pickTriIndices.end() && processedTris.find(tr2.ID()) == processedTris.end())
+                    candidates.Push(tr2.m_id, edge.GetOtherTriIndex(&tr), edge.m_angle);
             }
         };
 
@@ -687,13 +832,12 @@ void CMesh::GroupPickedTriangles()
         //and remove self, because it is already in it's group
         processedTris.insert(i);
         addNeighbours(m_tri2D[i]);
-        candidates.pop_front();
 
-        while(!candidates.empty())
+        while(!candidates.Empty())
         {
-            auto& c = candidates.front();
+            const CUnfoldFrontier::SCandidate c = candidates.Pop();
 
-            CIvoCommand* joinCmd = m_tri2D[c.first].m_myGroup->GetJoinEdgeCmd(&m_tri2D[c.first], c.second);
+            CIvoCommand* joinCmd = m_tri2D[c.tri].m_myGroup->GetJoinEdgeCmd(&m_tri2D[c.tri], c.referal);
             if(joinCmd)
             {
                 joinCmd->redo();
@@ -701,100 +845,194 @@ void CMesh::GroupPickedTriangles()
                 delete joinCmd;
             }
 
-            processedTris.insert(c.first);
+            processedTris.insert(c.tri);
 
-            addNeighbours(m_tri2D[c.first]);
-
-            candidates.pop_front();
+            addNeighbours(m_tri2D[c.tri]);
         }
     }
 
     cmd->undo();
 
-    CMesh::g_Mesh->m_undoStack.push(cmd);
-    UpdateGroupDepth();
+    PushCommand(cmd);
     ClearPickedTriangles();
 }
 
 std::vector<CMesh::STriGroup*> CMesh::GetGroupsInRange(const SAABBox2D &range)
 {
     std::vector<STriGroup*> groupsInRange;
-    for(auto& grp : m_groups)
+    m_groupTree.Query(range, [this, &range, &groupsInRange](int proxy)
     {
-        if(grp.GetAABBox().Intersects(range))
-            groupsInRange.push_back(&grp);
-    }
+        STriGroup* grp = static_cast<STriGroup*>(m_groupTree.GetUserData(proxy));
+        if(grp->GetAABBox().Intersects(range))
+            groupsInRange.push_back(grp);
+        return true;
+    });
+    //keep groups in drawing order
+    std::sort(groupsInRange.begin(), groupsInRange.end(), [](const STriGroup* a, const STriGroup* b)
+    {
+        return a->GetDepth() < b->GetDepth();
+    });
     return groupsInRange;
 }
 
+//topmost group, that has triangle under cursor
 CMesh::STriGroup* CMesh::GroupUnderCursor(const vec2& curPos)
 {
-    std::list<STriGroup*> possibleGroups;
-    for(STriGroup& grp : m_groups)
-    {
-        if(grp.GetAABBox().PointInside(curPos))
-            possibleGroups.push_back(&grp);
-    }
-    for(auto &grp : possibleGroups)
+    STriGroup* result = nullptr;
+    m_groupTree.Query(curPos, [this, &curPos, &result](int proxy)
     {
-        for(auto &tri : grp->m_tris)
+        STriGroup* grp = static_cast<STriGroup*>(m_groupTree.GetUserData(proxy));
+        if(!grp->GetAABBox().PointInside(curPos))
+            return true;
+        if(result && result->GetDepth() < grp->GetDepth())
+            return true;
+
+        const CAABBTree2D& triTree = grp->GetTriangleTree();
+        triTree.Query(grp->ToTriangleTreeSpace(curPos), [&](int triProxy)
         {
-            if(tri->PointInside(curPos))
-                return grp;
-        }
-    }
-    return nullptr;
+            const STriangle2D* tri = static_cast<const STriangle2D*>(triTree.GetUserData(triProxy));
+            if(!tri->PointInside(curPos))
+                return true;
+            result = grp;
+            return false;
+        });
+        return true;
+    });
+    return result;
 }
 
+//edge closest to cursor; ties are resolved in favour of topmost group
 void CMesh::GetStuffUnderCursor(const vec2& curPos, CMesh::STriangle2D*& tr, int &e) const
 {
-    std::list<const STriGroup*> possibleGroups;
-    for(auto &grp : m_groups)
-    {
-        if(grp.GetAABBox().PointInside(curPos))
-            possibleGroups.push_back(&grp);
-    }
     struct SClosestEdge
     {
+        const STriGroup *grp;
         CMesh::STriangle2D *t;
         int e;
         float score;
+
+        bool IsBetterThan(const SClosestEdge& other) const
+        {
+            if(score != other.score)
+                return score < other.score;
+            if(grp != other.grp)
+                return grp->GetDepth() < other.grp->GetDepth();
+            if(t != other.t)
+                return t->ID() < other.t->ID();
+            return this->e < other.e;
+        }
     };
-    std::list<SClosestEdge> chart;
+    SClosestEdge closest = { nullptr, nullptr, -1, 0.0f };
 
-    for(auto &grp : possibleGroups)
+    m_groupTree.Query(curPos, [this, &curPos, &closest](int proxy)
     {
-        for(auto &tri : grp->m_tris)
+        const STriGroup* grp = static_cast<const STriGroup*>(m_groupTree.GetUserData(proxy));
+        if(!grp->GetAABBox().PointInside(curPos))
+            return true;
+
+        const CAABBTree2D& triTree = grp->GetTriangleTree();
+        triTree.Query(grp->ToTriangleTreeSpace(curPos), [&](int triProxy)
         {
+            STriangle2D* tri = static_cast<STriangle2D*>(triTree.GetUserData(triProxy));
             float score = 0.0f;
-
             for(int i=0; i<3; ++i)
             if(tri->PointIsNearEdge(curPos, i, score))
             {
-                chart.push_back(SClosestEdge{tri, i, score});
+                const SClosestEdge candidate = { grp, tri, i, score };
+                if(closest.t == nullptr || candidate.IsBetterThan(closest))
+                    closest = candidate;
             }
-        }
-    }
-    if(chart.empty())
+            return true;
+        });
+        return true;
+    });
+
+    tr = closest.t;
+    if(tr)
+        e = closest.e;
+}
+
+const CMesh::STriangle2D* CMesh::GetEdgeTriangle(const SEdge& edge, std::size_t side) const
+{
+    assert(side < 2);
+    const std::uint32_t tri = (side == 0 ? edge.m_left : edge.m_right);
+    return (tri == NO_INDEX ?
+            nullptr :
+            &m_tri2D[tri]);
+}
+
+const CMesh::STriangle2D* CMesh::GetAnyEdgeTriangle(const SEdge& edge) const
+{
+    return GetEdgeTriangle(edge, edge.m_left == NO_INDEX ? 1 : 0);
+}
+
+void CMesh::SetEdgeSnapped(SEdge& edge, bool snapped)
+{
+    edge.m_snapped = snapped;
+    MarkGroupsModified(edge);
+}
+
+void CMesh::NextFlapPosition(SEdge& edge)
+{
+    switch(edge.m_flapPosition)
     {
-        tr = nullptr;
-        return;
+        case SEdge::FP_LEFT :
+        edge.m_flapPosition = SEdge::FP_RIGHT; break;
+
+        case SEdge::FP_RIGHT :
+        edge.m_flapPosition = SEdge::FP_BOTH; break;
+
+        case SEdge::FP_BOTH :
+        edge.m_flapPosition = SEdge::FP_NONE; break;
+
+        case SEdge::FP_NONE :
+        edge.m_flapPosition = SEdge::FP_LEFT; break;
+
+    default : break;
     }
-    chart.sort([](const SClosestEdge &i, const SClosestEdge &j) { return i.score < j.score; } );
-    tr = chart.front().t;
-    e = chart.front().e;
+    MarkGroupsModified(edge);
 }
 
+void CMesh::AttachGroupsToScene()
+{
+    for(STriGroup& grp : m_groups)
+        grp.AttachToScene(&m_groupTree);
+}
+
+//newer groups are above older ones; there is room for twice as many groups, so new groups get free slots
+//and removed ones leave gaps until the next full update
 void CMesh::UpdateGroupDepth()
 {
-    float total = static_cast<float>(m_groups.size());
-    float f = 1.0f;
+    m_depthCapacity = std::max<std::size_t>(m_groups.size() * 2, 16u);
+    m_depthStep = 500.0f/static_cast<float>(m_depthCapacity);
+    std::size_t slot = 0;
     for(auto &g : m_groups)
+        g.m_depth = static_cast<float>(++slot) * m_depthStep;
+    m_nextDepthSlot = slot + 1;
+}
+
+void CMesh::AssignGroupDepth(STriGroup& grp)
+{
+    if(m_nextDepthSlot > m_depthCapacity)
     {
-        g.m_depth = (f/total)*500.0f;
-        f += 1.0f;
+        UpdateGroupDepth();
+        return;
     }
-    STriGroup::ms_depthStep = 500.0f/total;
+    grp.m_depth = static_cast<float>(m_nextDepthSlot++) * m_depthStep;
+}
+
+CMesh::STriGroup& CMesh::CreateGroup()
+{
+    m_groups.emplace_back(this);
+    STriGroup& grp = m_groups.back();
+    grp.m_selfIt = std::prev(m_groups.end());
+    AssignGroupDepth(grp);
+    return grp;
+}
+
+void CMesh::RemoveGroup(STriGroup& grp)
+{
+    m_groups.erase(grp.m_selfIt);
 }
 
 void CMesh::CalculateAABBox()
@@ -833,6 +1071,7 @@ void CMesh::CalculateAABBox()
     }
     for(vec3& v : m_vertices)
         v -= toCenter;
+    ++m_geometryRevision;
 }
 
 vec3 CMesh::GetAABBoxCenter() const
@@ -852,76 +1091,61 @@ vec3 CMesh::GetSizeMillimeters() const
 
 bool CMesh::CanRedo() const
 {
-    return m_undoStack.canRedo();
+    return m_undoStack.CanRedo();
 }
 
 bool CMesh::CanUndo() const
 {
-    return m_undoStack.canUndo();
+    return m_undoStack.CanUndo();
+}
+
+std::size_t CMesh::GetUndoMemoryUsage() const
+{
+    return m_undoStack.GetMemoryUsage();
 }
 
 void CMesh::Undo()
 {
-    if(m_undoStack.canUndo())
+    if(m_undoStack.CanUndo())
     {
-        m_undoStack.undo();
-        UpdateGroupDepth();
+        m_undoStack.Undo();
     }
 }
 
 void CMesh::Redo()
 {
-    if(m_undoStack.canRedo())
+    if(m_undoStack.CanRedo())
     {
-        m_undoStack.redo();
-        UpdateGroupDepth();
+        m_undoStack.Redo();
     }
 }
 
+void CMesh::PushCommand(IMeshCommand* cmd)
+{
+    m_undoStack.SetMemoryBudget(static_cast<std::size_t>(CSettings::GetInstance().GetUndoMemoryLimit()) * 1024u * 1024u);
+    m_undoStack.Push(cmd);
+}
+
 void CMesh::NotifyGroupsMovement(const std::vector<STriGroup*>& groups, const std::vector<glm::vec2>& oldPositions)
 {
     assert(groups.size() == oldPositions.size());
 
-    if(groups.empty())
-        return;
-
-    CIvoCommand* cmd = new CIvoCommand();
-
-    int i = 0;
+    std::vector<float> rotations;
+    rotations.reserve(groups.size());
     for(auto* grp : groups)
-    {
-        const vec2& oldPos = oldPositions[i++];
-        CAtomicCommand cmdMov(CT_MOVE);
-        cmdMov.SetTriangle(grp->m_tris.front());
-        cmdMov.SetTranslation(grp->GetPosition() - oldPos);
-        grp->SetPosition(oldPos.x, oldPos.y);
-        cmd->AddAction(cmdMov);
-    }
-
-    m_undoStack.push(cmd);
+        rotations.push_back(grp->GetRotation());
+    NotifyGroupsTransformation(groups, oldPositions, rotations);
 }
 
 void CMesh::NotifyGroupsRotation(const std::vector<STriGroup*>& groups, const std::vector<float>& oldRotations)
 {
     assert(groups.size() == oldRotations.size());
 
-    if(groups.empty())
-        return;
-
-    CIvoCommand* cmd = new CIvoCommand();
-
-    int i = 0;
+    std::vector<vec2> positions;
+    positions.reserve(groups.size());
     for(auto* grp : groups)
-    {
-        const float oldRot = oldRotations[i++];
-        CAtomicCommand cmdRot(CT_ROTATE);
-        cmdRot.SetTriangle(grp->m_tris.front());
-        cmdRot.SetRotation(grp->GetRotation() - oldRot);
-        grp->SetRotation(oldRot);
-        cmd->AddAction(cmdRot);
-    }
-
-    m_undoStack.push(cmd);
+        positions.push_back(grp->GetPosition());
+    NotifyGroupsTransformation(groups, positions, oldRotations);
 }
 
 void CMesh::NotifyGroupsTransformation(const std::vector<STriGroup*>& groups, const std::vector<glm::vec2>& oldPositions, const std::vector<float>& oldRotations)
@@ -932,27 +1156,16 @@ void CMesh::NotifyGroupsTransformation(const std::vector<STriGroup*>& groups, co
     if(groups.empty())
         return;
 
-    CIvoCommand* cmd = new CIvoCommand();
+    CTransformCommand* cmd = new CTransformCommand();
 
-    int i = 0;
-    for(auto* grp : groups)
+    for(std::size_t i=0; i<groups.size(); ++i)
     {
-        const float oldRot = oldRotations[i];
-        CAtomicCommand cmdRot(CT_ROTATE);
-        cmdRot.SetTriangle(grp->m_tris.front());
-        cmdRot.SetRotation(grp->GetRotation() - oldRot);
-        grp->SetRotation(oldRot);
-        cmd->AddAction(cmdRot);
-
-        const vec2& oldPos = oldPositions[i++];
-        CAtomicCommand cmdMov(CT_MOVE);
-        cmdMov.SetTriangle(grp->m_tris.front());
-        cmdMov.SetTranslation(grp->GetPosition() - oldPos);
-        grp->SetPosition(oldPos.x, oldPos.y);
-        cmd->AddAction(cmdMov);
+        STriGroup* grp = groups[i];
+        cmd->AddGroup(grp, oldPositions[i], oldRotations[i], grp->GetPosition(), grp->GetRotation());
+        grp->SetTransform(oldPositions[i], oldRotations[i]);
     }
 
-    m_undoStack.push(cmd);
+    PushCommand(cmd);
 }
 
 QJsonObject CMesh::Serialize() const
@@ -965,6 +1178,8 @@ QJsonObject CMesh::Serialize() const
 
     {
         QJsonArray tri2DArray;
+        for(const STriGroup& g : m_groups)
+            g.UpdateWorldData();
         for(const STriangle2D& tr2d : m_tri2D)
             tri2DArray.append(tr2d.Serialize());
         meshObject.insert("triangles2D", tri2DArray);
@@ -987,10 +1202,10 @@ QJsonObject CMesh::Serialize() const
         for(const SEdge& e : m_edges)
         {
             glm::ivec2 edgeTris(-1, -1);
-            if(e.m_left)
-                edgeTris[0] = static_cast<int>(e.m_left - &m_tri2D[0]);
-            if(e.m_right)
-                edgeTris[1] = static_cast<int>(e.m_right - &m_tri2D[0]);
+            if(e.m_left != NO_INDEX)
+                edgeTris[0] = static_cast<int>(e.m_left);
+            if(e.m_right != NO_INDEX)
+                edgeTris[1] = static_cast<int>(e.m_right);
             edgptrInd.emplace_back(edgeTris);
         }
         meshObject.insert("edgeTriangles", ToJSON(edgptrInd));
@@ -1002,7 +1217,6 @@ QJsonObject CMesh::Serialize() const
 void CMesh::Deserialize(const QJsonObject& obj)
 {
     Clear();
-    g_Mesh = this;
 
     FromJSON(obj["uvCoords"], m_uvCoords);
     FromJSON(obj["normals"], m_normals);
@@ -1019,6 +1233,7 @@ void CMesh::Deserialize(const QJsonObject& obj)
     }
     {
         const QJsonArray edgesArray = obj["edges2D"].toArray();
+        m_edges.reserve(edgesArray.size());
         for(int i=0; i<edgesArray.size(); ++i)
         {
             m_edges.emplace_back();
@@ -1029,8 +1244,7 @@ void CMesh::Deserialize(const QJsonObject& obj)
         const QJsonArray groupsArray = obj["groups"].toArray();
         for(int i=0; i<groupsArray.size(); ++i)
         {
-            m_groups.emplace_back();
-            m_groups.back().Deserialize(groupsArray.at(i).toObject());
+            CreateGroup().Deserialize(groupsArray.at(i).toObject());
         }
     }
     {
@@ -1039,10 +1253,9 @@ void CMesh::Deserialize(const QJsonObject& obj)
         if(edgptrInd.size() != m_edges.size())
             throw std::runtime_error("File corrupted: edge triangles data is incorrect!");
 
-        auto eIter = m_edges.begin();
-        for(std::size_t i=0; i<m_edges.size(); ++i, eIter++)
+        for(std::size_t i=0; i<m_edges.size(); ++i)
         {
-            SEdge& e = *eIter;
+            SEdge& e = m_edges[i];
 
             const int leftTriInd = edgptrInd[i][0];
             const int rightTriInd = edgptrInd[i][1];
@@ -1050,26 +1263,298 @@ void CMesh::Deserialize(const QJsonObject& obj)
                rightTriInd >= static_cast<int>(m_tri2D.size()))
                 throw std::runtime_error("File corrupted: triangle indices are out of range!");
 
-            if(leftTriInd >= 0)
+            e.m_left = leftTriInd >= 0 ? static_cast<std::uint32_t>(leftTriInd) : NO_INDEX;
+            e.m_right = rightTriInd >= 0 ? static_cast<std::uint32_t>(rightTriInd) : NO_INDEX;
+        }
+        LinkEdges();
+    }
+
+    CalculateFlatNormals();
+    CalculateAABBox();
+    UpdateGroupDepth();
+    AttachGroupsToScene();
+}
+
+void CMesh::Serialize(CBinaryWriter& writer) const
+{
+    writer.WriteArray(m_uvCoords);
+    writer.WriteArray(m_normals);
+    writer.WriteArray(m_vertices);
+    writer.WriteArray(m_triangles);
+
+    //only initial state of 2D triangles is stored, rotated data is restored on load
+    {
+        const std::size_t numTris = m_tri2D.size();
+        std::vector<std::uint64_t> ids(numTris);
+        std::vector<vec2>          vtx(numTris * 3);
+        std::vector<vec2>          norm(numTris * 3);
+        std::vector<std::uint8_t>  flapSharp(numTris * 3);
+        std::vector<float>         edgeLen(numTris * 3);
+        std::vector<vec2>          position(numTris);
+        std::vector<float>         rotation(numTris);
+        std::vector<float>         angleOY(numTris * 3);
+        std::vector<mat3>          relativeMx(numTris);
+        for(std::size_t i=0; i<numTris; ++i)
+        {
+            const STriangle2D& tr = m_tri2D[i];
+            ids[i] = static_cast<std::uint64_t>(tr.m_id);
+            for(int j=0; j<3; ++j)
             {
-                e.m_left = &m_tri2D[leftTriInd];
-                e.m_left->m_edges[e.m_leftIndex] = &e;
-            } else {
-                e.m_left = nullptr;
+                vtx[i*3+j] = tr.m_vtx[j];
+                norm[i*3+j] = tr.m_norm[j];
+                flapSharp[i*3+j] = tr.m_flapSharp[j] ? 1u : 0u;
+                edgeLen[i*3+j] = tr.m_edgeLen[j];
+                angleOY[i*3+j] = tr.m_angleOY[j];
             }
-            if(rightTriInd >= 0)
+            position[i] = tr.GetPosition();
+            rotation[i] = tr.GetRotation();
+            relativeMx[i] = tr.m_relativeMx;
+        }
+        writer.WriteArray(ids);
+        writer.WriteArray(vtx);
+        writer.WriteArray(norm);
+        writer.WriteArray(flapSharp);
+        writer.WriteArray(edgeLen);
+        writer.WriteArray(position);
+        writer.WriteArray(rotation);
+        writer.WriteArray(angleOY);
+        writer.WriteArray(relativeMx);
+    }
+    {
+        //left triangle, right triangle, left index, right index
+        std::vector<glm::ivec4>   edgeTris;
+        std::vector<float>        angles;
+        std::vector<std::uint8_t> snapped;
+        std::vector<std::uint8_t> flapPositions;
+        std::vector<std::uint8_t> foldTypes;
+        edgeTris.reserve(m_edges.size());
+        angles.reserve(m_edges.size());
+        snapped.reserve(m_edges.size());
+        flapPositions.reserve(m_edges.size());
+        foldTypes.reserve(m_edges.size());
+        for(const SEdge& e : m_edges)
+        {
+            edgeTris.emplace_back(e.m_left != NO_INDEX ? static_cast<int>(e.m_left) : -1,
+                                  e.m_right != NO_INDEX ? static_cast<int>(e.m_right) : -1,
+                                  e.m_leftIndex,
+                                  e.m_rightIndex);
+            angles.push_back(e.m_angle);
+            snapped.push_back(e.m_snapped ? 1u : 0u);
+            flapPositions.push_back(static_cast<std::uint8_t>(e.m_flapPosition));
+            foldTypes.push_back(static_cast<std::uint8_t>(e.m_foldType));
+        }
+        writer.WriteArray(edgeTris);
+        writer.WriteArray(angles);
+        writer.WriteArray(snapped);
+        writer.WriteArray(flapPositions);
+        writer.WriteArray(foldTypes);
+    }
+    {
+        std::vector<std::uint32_t> triCounts;
+        std::vector<std::uint32_t> triIndices;
+        std::vector<vec2>          toTopLeft;
+        std::vector<vec2>          toRightDown;
+        std::vector<float>         aabbHSide;
+        std::vector<vec2>          position;
+        std::vector<float>         rotation;
+        std::vector<mat3>          matrix;
+        triIndices.reserve(m_tri2D.size());
+        for(const STriGroup& g : m_groups)
+        {
+            triCounts.push_back(static_cast<std::uint32_t>(g.m_tris.size()));
+            triIndices.insert(triIndices.end(), g.m_tris.begin(), g.m_tris.end());
+            g.ValidateBBoxVectors();
+            toTopLeft.push_back(g.m_toTopLeft);
+            toRightDown.push_back(g.m_toRightDown);
+            aabbHSide.push_back(g.m_aabbHSide);
+            position.push_back(g.m_position);
+            rotation.push_back(g.m_rotation);
+            matrix.push_back(g.m_matrix);
+        }
+        writer.WriteArray(triCounts);
+        writer.WriteArray(triIndices);
+        writer.WriteArray(toTopLeft);
+        writer.WriteArray(toRightDown);
+        writer.WriteArray(aabbHSide);
+        writer.WriteArray(position);
+        writer.WriteArray(rotation);
+        writer.WriteArray(matrix);
+    }
+}
+
+void CMesh::Deserialize(CBinaryReader& reader)
+{
+    Clear();
+
+    reader.ReadArray(m_uvCoords);
+    reader.ReadArray(m_normals);
+    reader.ReadArray(m_vertices);
+    reader.ReadArray(m_triangles);
+
+    const std::size_t numVertices = std::min(m_vertices.size(), std::min(m_normals.size(), m_uvCoords.size()));
+    for(const uvec4& t : m_triangles)
+        if(t[0] >= numVertices || t[1] >= numVertices || t[2] >= numVertices)
+            throw std::runtime_error("File corrupted: vertex index of triangle is out of range!");
+
+    {
+        std::vector<std::uint64_t> ids;
+        std::vector<vec2>          vtx;
+        std::vector<vec2>          norm;
+        std::vector<std::uint8_t>  flapSharp;
+        std::vector<float>         edgeLen;
+        std::vector<vec2>          position;
+        std::vector<float>         rotation;
+        std::vector<float>         angleOY;
+        std::vector<mat3>          relativeMx;
+        reader.ReadArray(ids);
+        reader.ReadArray(vtx);
+        reader.ReadArray(norm);
+        reader.ReadArray(flapSharp);
+        reader.ReadArray(edgeLen);
+        reader.ReadArray(position);
+        reader.ReadArray(rotation);
+        reader.ReadArray(angleOY);
+        reader.ReadArray(relativeMx);
+
+        const std::size_t numTris = ids.size();
+        if(vtx.size() != numTris * 3 || norm.size() != numTris * 3 || flapSharp.size() != numTris * 3 ||
+           edgeLen.size() != numTris * 3 || angleOY.size() != numTris * 3 || position.size() != numTris ||
+           rotation.size() != numTris || relativeMx.size() != numTris || numTris != m_triangles.size())
+            throw std::runtime_error("File corrupted: 2D triangles data is incorrect!");
+
+        m_tri2D.resize(numTris);
+        for(std::size_t i=0; i<numTris; ++i)
+        {
+            if(ids[i] >= numTris)
+                throw std::runtime_error("File corrupted: 2D triangles data is incorrect!");
+            STriangle2D& tr = m_tri2D[i];
+            tr.m_id = static_cast<std::size_t>(ids[i]);
+            for(int j=0; j<3; ++j)
+            {
+                tr.m_vtx[j] = vtx[i*3+j];
+                tr.m_norm[j] = norm[i*3+j];
+                tr.m_flapSharp[j] = flapSharp[i*3+j] != 0u;
+                tr.m_edgeLen[j] = edgeLen[i*3+j];
+                tr.m_angleOY[j] = angleOY[i*3+j];
+            }
+            tr.m_position = position[i];
+            tr.m_relativeMx = relativeMx[i];
+            tr.SetRotation(rotation[i]);
+        }
+    }
+    {
+        std::vector<glm::ivec4>   edgeTris;
+        std::vector<float>        angles;
+        std::vector<std::uint8_t> snapped;
+        std::vector<std::uint8_t> flapPositions;
+        std::vector<std::uint8_t> foldTypes;
+        reader.ReadArray(edgeTris);
+        reader.ReadArray(angles);
+        reader.ReadArray(snapped);
+        reader.ReadArray(flapPositions);
+        reader.ReadArray(foldTypes);
+
+        const std::size_t numEdges = edgeTris.size();
+        if(angles.size() != numEdges || snapped.size() != numEdges ||
+           flapPositions.size() != numEdges || foldTypes.size() != numEdges)
+            throw std::runtime_error("File corrupted: edges data is incorrect!");
+
+        const int numTris = static_cast<int>(m_tri2D.size());
+        //every side of every triangle is claimed by exactly one edge
+        std::vector<char> sideTaken(m_tri2D.size()*3, 0);
+        auto claimSide = [&sideTaken, numTris](int tri, int side)
+        {
+            if(tri < 0)
+                return;
+            if(tri >= numTris || side < 0 || side > 2 || sideTaken[tri*3 + side])
+                throw std::runtime_error("File corrupted: edges data is incorrect!");
+            sideTaken[tri*3 + side] = 1;
+        };
+        m_edges.reserve(numEdges);
+        for(std::size_t i=0; i<numEdges; ++i)
+        {
+            const glm::ivec4& tris = edgeTris[i];
+            if(tris[0] < -1 || tris[1] < -1 || (tris[0] < 0 && tris[1] < 0) ||
+               flapPositions[i] > SEdge::FP_BOTH || foldTypes[i] > SEdge::FT_FLAT)
+                throw std::runtime_error("File corrupted: edges data is incorrect!");
+            claimSide(tris[0], tris[2]);
+            claimSide(tris[1], tris[3]);
+
+            m_edges.emplace_back();
+            SEdge& e = m_edges.back();
+            e.m_leftIndex = tris[2];
+            e.m_rightIndex = tris[3];
+            e.m_angle = angles[i];
+            e.m_snapped = snapped[i] != 0u;
+            e.m_flapPosition = static_cast<SEdge::EFlapPosition>(flapPositions[i]);
+            e.m_foldType = static_cast<SEdge::EFoldType>(foldTypes[i]);
+            if(tris[0] >= 0)
+                e.m_left = static_cast<std::uint32_t>(tris[0]);
+            if(tris[1] >= 0)
+                e.m_right = static_cast<std::uint32_t>(tris[1]);
+        }
+        LinkEdges();
+        for(const STriangle2D& tr : m_tri2D)
+            if(tr.m_edges[0] == NO_INDEX || tr.m_edges[1] == NO_INDEX || tr.m_edges[2] == NO_INDEX)
+                throw std::runtime_error("File corrupted: triangle has no edge on one of its sides!");
+    }
+    {
+        std::vector<std::uint32_t> triCounts;
+        std::vector<std::uint32_t> triIndices;
+        std::vector<vec2>          toTopLeft;
+        std::vector<vec2>          toRightDown;
+        std::vector<float>         aabbHSide;
+        std::vector<vec2>          position;
+        std::vector<float>         rotation;
+        std::vector<mat3>          matrix;
+        reader.ReadArray(triCounts);
+        reader.ReadArray(triIndices);
+        reader.ReadArray(toTopLeft);
+        reader.ReadArray(toRightDown);
+        reader.ReadArray(aabbHSide);
+        reader.ReadArray(position);
+        reader.ReadArray(rotation);
+        reader.ReadArray(matrix);
+
+        const std::size_t numGroups = triCounts.size();
+        if(toTopLeft.size() != numGroups || toRightDown.size() != numGroups || aabbHSide.size() != numGroups ||
+           position.size() != numGroups || rotation.size() != numGroups || matrix.size() != numGroups)
+            throw std::runtime_error("File corrupted: groups data is incorrect!");
+
+        std::size_t nextTri = 0;
+        for(std::size_t i=0; i<numGroups; ++i)
+        {
+            STriGroup& g = CreateGroup();
+            if(triCounts[i] == 0 || triCounts[i] > triIndices.size() - nextTri)
+                throw std::runtime_error("File corrupted: groups data is incorrect!");
+            for(std::uint32_t t=0; t<triCounts[i]; ++t)
             {
-                e.m_right = &m_tri2D[rightTriInd];
-                e.m_right->m_edges[e.m_rightIndex] = &e;
-            } else {
-                e.m_right = nullptr;
+                const std::uint32_t trInd = triIndices[nextTri++];
+                if(trInd >= m_tri2D.size())
+                    throw std::runtime_error("File corrupted: triangle index in group is out of range!");
+                if(m_tri2D[trInd].m_myGroup != nullptr)
+                    throw std::runtime_error("File corrupted: triangle belongs to several groups!");
+                g.m_tris.push_back(trInd);
+                m_tri2D[trInd].m_myGroup = &g;
             }
+            g.m_toTopLeft = toTopLeft[i];
+            g.m_toRightDown = toRightDown[i];
+            g.m_aabbHSide = aabbHSide[i];
+            g.m_position = position[i];
+            g.m_rotation = rotation[i];
+            g.m_matrix = matrix[i];
+            g.m_triTreeValid = false;
+            g.Modified();
         }
+        for(const STriangle2D& tr : m_tri2D)
+            if(tr.m_myGroup == nullptr)
+                throw std::runtime_error("File corrupted: triangle does not belong to any group!");
     }
 
     CalculateFlatNormals();
     CalculateAABBox();
     UpdateGroupDepth();
+    AttachGroupsToScene();
 }
 
 void CMesh::ApplyScale(const float scale)
@@ -1087,16 +1572,16 @@ void CMesh::Scale(const float scale)
 {
     CAtomicCommand cmdSca(CT_SCALE);
     cmdSca.SetScale(scale);
-    cmdSca.SetTriangle(m_groups.front().m_tris.front());
+    cmdSca.SetTriangle(m_groups.front().GetTriangles().front());
 
     CIvoCommand* cmd = new CIvoCommand();
     cmd->AddAction(cmdSca);
-    m_undoStack.push(cmd);
+    PushCommand(cmd);
 }
 
 SAABBox2D CMesh::GetAABBox2D() const
 {
-    SAABBox2D bbox(m_groups.front().m_toRightDown, m_groups.front().m_toTopLeft);
+    SAABBox2D bbox = m_groups.front().GetAABBox();
 
     for(const STriGroup& grp : m_groups)
         bbox = bbox.Union(grp.GetAABBox());
@@ -1108,7 +1593,7 @@ bool CMesh::Intersects(const SAABBox2D &bbox) const
 {
     for(const STriGroup& grp : m_groups)
     {
-        if(bbox.Intersects(SAABBox2D(grp.m_toRightDown, grp.m_toTopLeft)))
+        if(bbox.Intersects(grp.GetAABBox()))
             return true;
     }
     return false;
@@ -17,7 +17,6 @@
 */
 #ifndef MESH_H
 #define MESH_H
-#include <QUndoStack>
 #include <QJsonObject>
 #include <string>
 #include <vector>
@@ -27,14 +26,24 @@
 #include <glm/vec3.hpp>
 #include <glm/vec2.hpp>
 #include <list>
+#include <atomic>
+#include <iterator>
 #include <cstddef>
+#include <cstdint>
 #include "pdo/pdotools.h"
 #include "geometric/aabbox.h"
+#include "geometric/aabbtree.h"
+#include "geometric/trianglebatch.h"
 #include "notification/notification.h"
+#include "mesh/undostack.h"
 
 extern const int IVO_VERSION;
 
 class CIvoCommand;
+class IMeshCommand;
+class CBinaryWriter;
+class CBinaryReader;
+class CLoadProgress;
 struct aiScene;
 struct aiNode;
 
@@ -49,14 +58,18 @@ public:
     struct STriangle2D;
     struct STriGroup;
 
+    //triangles and edges refer to each other by 32-bit indices into mesh's arrays
+    static constexpr std::uint32_t NO_INDEX = 0xFFFFFFFFu;
+
     CMesh();
     ~CMesh();
 
-    void                        LoadMesh(const std::string& path);
+    void                        LoadMesh(const std::string& path, CLoadProgress* progress = nullptr);
     void                        LoadFromPDO(const std::vector<PDO_Face>&                  faces,
                                             const std::vector<std::unique_ptr<PDO_Edge>>& edges,
                                             const std::vector<glm::vec3>&                 vertices3D,
-                                            const std::unordered_map<unsigned, PDO_Part>& parts);
+                                            const std::unordered_map<unsigned, PDO_Part>& parts,
+                                            CLoadProgress*                                progress = nullptr);
 
     float                       GetBSphereRadius() const { return m_bSphereRadius; }
     const glm::vec3*            GetAABBox()        const { return m_aabbox; }
@@ -68,7 +81,7 @@ public:
         <glm::vec3>&            GetVertices()      const { return m_vertices; }
     const std::vector
         <glm::uvec4>&           GetTriangles()     const { return m_triangles; }
-    const std::list
+    const std::vector
         <SEdge>&                GetEdges()         const { return m_edges; }
     const std::list
         <STriGroup>&            GetGroups()        const { return m_groups; }
@@ -77,14 +90,24 @@ public:
 
     const std::unordered_map
         <unsigned,std::string>& GetMaterials()     const { return m_materials; }
+    //change whenever 3D geometry or set of picked triangles changes
+    std::uint64_t               GetGeometryRevision() const { return m_geometryRevision; }
+    std::uint64_t               GetPickRevision()     const { return m_pickRevision; }
 
     void                        SetMaterials(const std::unordered_map<unsigned, std::string>& materials) { m_materials = materials; }
 
     std::vector<STriGroup*>     GetGroupsInRange(const SAABBox2D& range);
     CMesh::STriGroup*           GroupUnderCursor(const glm::vec2& curPos);
     void                        GetStuffUnderCursor(const glm::vec2& curPos, CMesh::STriangle2D*& tr, int &e) const;
+    //side 0 is left triangle, 1 is right one; nullptr if edge has no triangle there
+    const STriangle2D*          GetEdgeTriangle(const SEdge& edge, std::size_t side) const;
+    const STriangle2D*          GetAnyEdgeTriangle(const SEdge& edge) const;
+    void                        SetEdgeSnapped(SEdge& edge, bool snapped);
+    void                        NextFlapPosition(SEdge& edge);
     bool                        CanUndo() const;
     bool                        CanRedo() const;
+    //bytes held by undo history
+    std::size_t                 GetUndoMemoryUsage() const;
     void                        Undo();
     void                        Redo();
     void                        Clear();
@@ -93,8 +116,10 @@ public:
     void                        NotifyGroupsTransformation(const std::vector<STriGroup*>& groups, const std::vector<glm::vec2>& oldPositions, const std::vector<float>& oldRotations);
     QJsonObject                 Serialize() const;
     void                        Deserialize(const QJsonObject& obj);
+    void                        Serialize(CBinaryWriter& writer) const;
+    void                        Deserialize(CBinaryReader& reader);
     void                        Scale(const float scale);
-    bool                        PackGroups(bool undoable=true);
+    bool                        PackGroups(bool undoable=true, CLoadProgress* progress=nullptr);
     glm::vec3                   GetSizeMillimeters() const;
     glm::vec3                   GetAABBoxCenter() const;
     void                        SetTriangleAsPicked(std::size_t index);
@@ -106,18 +131,24 @@ public:
     bool                        Intersects(const SAABBox2D& bbox) const;
 
 private:
-    static CMesh*               GetMesh() { return g_Mesh; }
     void                        ApplyScale(const float scale);
-    void                        AddMeshesFromAIScene(const aiScene* scene, const aiNode* node);
+    void                        PushCommand(IMeshCommand* cmd);
+    void                        AddMeshesFromAIScene(const aiScene* scene, const aiNode* node, unsigned& unnamedMatIndex);
     void                        CalculateFlatNormals();
-    void                        FillAdjTri_Gen2DTri();
+    void                        FillAdjTri_Gen2DTri(CLoadProgress& progress);
     void                        DetermineFoldParams(std::size_t i, std::size_t j, int e1, int e2);
-    void                        GroupTriangles(float maxAngleDeg);
+    void                        LinkEdges();
+    std::uint32_t               IndexOf(const STriangle2D* tr) const;
+    void                        MarkGroupsModified(const SEdge& edge);
+    void                        GroupTriangles(float maxAngleDeg, CLoadProgress& progress);
     void                        UpdateGroupDepth();
+    void                        AssignGroupDepth(STriGroup& grp);
+    STriGroup&                  CreateGroup();
+    void                        RemoveGroup(STriGroup& grp);
     void                        CalculateAABBox();
     void                        SetFoldType(SEdge& edg);
+    void                        AttachGroupsToScene();
 
-    static CMesh*               g_Mesh;
     std::vector<glm::vec2>      m_uvCoords;
     std::vector<glm::vec3>      m_normals;
     std::vector<glm::vec3>      m_vertices;
@@ -129,12 +160,18 @@ private:
     //generated stuff
     std::vector<glm::vec3>      m_flatNormals;
     std::vector<STriangle2D>    m_tri2D;
-    std::list<SEdge>            m_edges;
+    std::vector<SEdge>          m_edges;
+    CAABBTree2D                 m_groupTree; //must outlive groups
     std::list<STriGroup>        m_groups;
+    std::size_t                 m_depthCapacity; //depth slots [1, capacity] share range of depths
+    std::size_t                 m_nextDepthSlot;
+    float                       m_depthStep;
     glm::vec3                   m_aabbox[8];
     float                       m_bSphereRadius;
+    std::uint64_t               m_geometryRevision;
+    std::uint64_t               m_pickRevision;
 
-    QUndoStack                  m_undoStack;
+    CUndoStack                  m_undoStack;
 
     friend class CAtomicCommand;
 
@@ -159,12 +196,18 @@ public:
 
     private:
         void                    Init();
+        //world data must be up to date, before triangle is moved to other group
+        void                    UpdateWorldData() const;
+        const glm::vec2&        GetRotatedVertex(size_t index) const;
+        const glm::vec2&        GetPosition() const;
+        float                   GetRotation() const;
         void                    SetRelMx(glm::mat3 &invParentMx);
         void                    SetRotation(float degCCW);
         void                    SetPosition(glm::vec2 pos);
         void                    Scale(const float scale);
         void                    ComputeNormals();
-        void                    GroupHasTransformed(const glm::mat3 &parMx);
+        glm::mat3               GetTransformedMatrix(const glm::mat3 &parMx) const;
+        void                    GetTransformedVertices(const glm::mat3 &parMx, glm::vec2 (&vertices)[3]) const;
         static bool             EdgesIntersect(const glm::vec2 &e1v1, const glm::vec2 &e1v2, const glm::vec2 &e2v1, const glm::vec2 &e2v2);
 
         QJsonObject             Serialize() const;
@@ -172,31 +215,72 @@ public:
 
         std::size_t             m_id;
         glm::vec2               m_vtx[3]; //initial position (imagine this is constant)
-        glm::vec2               m_vtxR[3]; //rotated only
-        glm::vec2               m_vtxRT[3]; //rotated && translated
+        //world data below is derived from group's matrix on demand, see UpdateWorldData
+        mutable glm::vec2       m_vtxR[3]; //rotated only
+        mutable glm::vec2       m_vtxRT[3]; //rotated && translated
         glm::vec2               m_norm[3]; //perpendicular to edges
-        glm::vec2               m_normR[3];
+        mutable glm::vec2       m_normR[3];
         bool                    m_flapSharp[3];
         float                   m_edgeLen[3];
         STriGroup*              m_myGroup = nullptr;
-        glm::vec2               m_position;
-        float                   m_rotation;
+        mutable glm::vec2       m_position;
+        mutable float           m_rotation;
         float                   m_angleOY[3];
         glm::mat3               m_relativeMx;
-        SEdge*                  m_edges[3] = {nullptr, nullptr, nullptr};
+        std::uint32_t           m_edges[3] = {NO_INDEX, NO_INDEX, NO_INDEX}; //indices in CMesh::m_edges
+        std::uint64_t           m_visitEpoch = 0; //marks triangles visited by graph searches
+        mutable std::uint64_t   m_transformRevision = 0; //group's transform world data is derived from
 
         friend class CMesh;
         friend struct CMesh::STriGroup;
     };
 
+    //triangles of a group; they are stored as indices into mesh's contiguous array of triangles
+    class CTriangleRange
+    {
+    public:
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = STriangle2D*;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = STriangle2D* const*;
+            using reference         = STriangle2D*;
+
+            const_iterator(STriangle2D* base, const std::uint32_t* index) : m_base(base), m_index(index) {}
+            STriangle2D*        operator*() const { return m_base + *m_index; }
+            const_iterator&     operator++() { ++m_index; return *this; }
+            const_iterator      operator++(int) { const_iterator old(*this); ++m_index; return old; }
+            bool                operator==(const const_iterator& o) const { return m_index == o.m_index; }
+            bool                operator!=(const const_iterator& o) const { return m_index != o.m_index; }
+
+        private:
+            STriangle2D*         m_base;
+            const std::uint32_t* m_index;
+        };
+
+        CTriangleRange(STriangle2D* base, const std::vector<std::uint32_t>& indices) : m_base(base), m_indices(&indices) {}
+        const_iterator          begin() const { return const_iterator(m_base, m_indices->data()); }
+        const_iterator          end() const { return const_iterator(m_base, m_indices->data() + m_indices->size()); }
+        std::size_t             size() const { return m_indices->size(); }
+        bool                    empty() const { return m_indices->empty(); }
+        STriangle2D*            front() const { return m_base + m_indices->front(); }
+        STriangle2D*            operator[](std::size_t i) const { return m_base + (*m_indices)[i]; }
+
+    private:
+        STriangle2D*                        m_base;
+        const std::vector<std::uint32_t>*   m_indices;
+    };
+
     struct SEdge
     {
         SEdge() = default;
-        //non-copyable
+        //non-copyable; edges are moved only while CMesh::m_edges is filled
         SEdge(const SEdge& o) = delete;
-        SEdge(const SEdge&& o) = delete;
+        SEdge(SEdge&& o) = default;
         SEdge& operator=(const SEdge& o) = delete;
-        SEdge& operator=(const SEdge&& o) = delete;
+        SEdge& operator=(SEdge&& o) = default;
 
         enum EFlapPosition
         {
@@ -213,14 +297,11 @@ public:
         };
 
         float                   GetAngle() const { return m_angle; }
-        void                    SetSnapped(bool snapped);
-        void                    NextFlapPosition();
-        inline bool             HasTwoTriangles() const { return m_left && m_right; }
+        inline bool             HasTwoTriangles() const { return m_left != NO_INDEX && m_right != NO_INDEX; }
+        //triangles of edge are resolved through mesh of the given one, so it must be in a group
         STriangle2D*            GetOtherTriangle(const STriangle2D* aFirstTri) const;
         int                     GetOtherTriIndex(const STriangle2D* aFirstTri) const;
-        STriangle2D*            GetAnyTriangle() const;
         int                     GetAnyTriIndex() const;
-        STriangle2D*            GetTriangle(size_t index) const;
         int                     GetTriIndex(size_t index) const;
         bool                    IsSnapped() const;
         EFlapPosition           GetFlapPosition() const;
@@ -229,9 +310,10 @@ public:
     private:
         QJsonObject             Serialize() const;
         void                    Deserialize(const QJsonObject& obj);
+        std::uint32_t           GetOtherTriangle(std::uint32_t firstTri) const;
 
-        STriangle2D*            m_left = nullptr;
-        STriangle2D*            m_right = nullptr;
+        std::uint32_t           m_left = NO_INDEX; //indices in CMesh::m_tri2D
+        std::uint32_t           m_right = NO_INDEX;
         int                     m_leftIndex;
         int                     m_rightIndex;
         float                   m_angle;
@@ -244,7 +326,8 @@ public:
 
     struct STriGroup
     {
-        STriGroup();
+        explicit STriGroup(CMesh* mesh);
+        ~STriGroup();
         //non-copyable
         STriGroup(const STriGroup& o) = delete;
         STriGroup(const STriGroup&& o) = delete;
@@ -252,46 +335,89 @@ public:
         STriGroup& operator=(const STriGroup&& o) = delete;
 
         SAABBox2D               GetAABBox() const;
+        //bounding box group would have with given rotation; group is not modified
+        SAABBox2D               GetAABBoxForRotation(float angle) const;
+        //vertices of all triangles (3 per triangle) group would have with given rotation
+        void                    GetVerticesForRotation(float angle, std::vector<glm::vec2>& vertices) const;
         void                    JoinEdge(STriangle2D* tr, int e);
         void                    BreakEdge(STriangle2D* tr, int e);
         void                    SetRotation(float angle);
         void                    SetPosition(float x, float y);
+        //sets both position and rotation at once
+        void                    SetTransform(const glm::vec2& position, float angle);
         inline glm::vec2        GetPosition() const { return m_position; }
         inline float            GetRotation() const { return m_rotation; }
         const float&            GetDepth() const;
         const float&            GetAABBHalfSide() const;
+        //changes whenever group's geometry in local space, its edges or flaps change
+        inline std::uint64_t    GetRevision() const { return m_revision; }
+        //brings world data of all triangles up to date in one sweep; call before reading all of them
+        void                    UpdateWorldData() const;
 
-        const std::list
-            <STriangle2D*>&     GetTriangles() const;
+        CTriangleRange          GetTriangles() const;
 
-        static float            GetDepthStep();
+        float                   GetDepthStep() const;
 
     private:
         void                    CentrateOrigin();
         bool                    AddTriangle(STriangle2D* tr, STriangle2D* referal);
-        void                    AttachGroup(STriangle2D* tr2, int e2);
+        void                    Absorb(STriGroup& other);
+        STriGroup&              AttachGroup(STriangle2D* tr2, int e2); //returns survivor, may remove this group
         void                    BreakGroup(STriangle2D* tr2, int e2);
         CIvoCommand*            GetJoinEdgeCmd(STriangle2D* tr, int e);
         CIvoCommand*            GetBreakEdgeCmd(STriangle2D* tr, int e);
+        bool                    IsCutOff(STriangle2D* tr, int e, std::vector<STriangle2D*>* trSide) const;
         QJsonObject             Serialize() const;
         void                    Deserialize(const QJsonObject& obj);
         void                    Scale(const float scale);
-        void                    ResetBBoxVectors();
-        void                    RecalcBBoxVectors();
-
-        std::list<STriangle2D*> m_tris;
-        glm::vec2               m_toTopLeft;
-        glm::vec2               m_toRightDown;
+        void                    ResetBBoxVectors() const;
+        glm::mat3               GetMatrixForRotation(float angle) const;
+        void                    RecalcBBoxVectors() const;
+        void                    ValidateBBoxVectors() const;
+        void                    ResetTriangleTree();
+        void                    InsertToTriangleTree(STriangle2D* tr);
+        const CAABBTree2D&      GetTriangleTree() const;
+        SAABBox2D               GetTriangleTreeBBox(const STriangle2D& tr) const;
+        glm::vec2               ToTriangleTreeSpace(const glm::vec2& point) const;
+        SAABBox2D               GetSceneBBox() const;
+        void                    AttachToScene(CAABBTree2D* sceneTree);
+        void                    UpdateSceneProxy();
+        void                    Modified();
+        void                    Transformed();
+
+        std::vector<std::uint32_t> m_tris; //indices in CMesh::m_tri2D
+        CMesh*                  m_mesh;
+        //exact bounding box is recalculated lazily after rotation
+        mutable glm::vec2       m_toTopLeft;
+        mutable glm::vec2       m_toRightDown;
+        mutable bool            m_bboxValid;
         float                   m_aabbHSide;
         float                   m_depth;
         glm::vec2               m_position;
         float                   m_rotation;
         glm::mat3               m_matrix;
-
-        static float            ms_depthStep;
+        //triangles in group's local space, shifted by m_triTreeOffset; built lazily
+        mutable CAABBTree2D     m_triTree;
+        mutable bool            m_triTreeValid;
+        glm::vec2               m_triTreeOffset;
+        CAABBTree2D*            m_sceneTree;
+        int                     m_sceneProxy;
+        std::uint64_t           m_revision;
+        std::uint64_t           m_transformRevision; //changes whenever m_matrix is moved or rotated
+        //local geometry of m_tris in the same order, rebuilt when m_revision changes
+        mutable CTriangleBatch  m_batch;
+        mutable std::uint64_t   m_batchRevision;
+        mutable std::uint64_t   m_worldRevision; //transform revision all triangles are up to date with
+        std::list<STriGroup>::iterator m_selfIt; //in CMesh::m_groups
+
+        //shared by all meshes, so revisions and epochs stay unique when meshes are processed concurrently
+        static std::atomic<std::uint64_t> ms_revisionCounter;
+        static std::atomic<std::uint64_t> ms_visitEpoch;
 
         friend class CMesh;
         friend class CAtomicCommand;
+        friend struct CMesh::SEdge;
+        friend struct CMesh::STriangle2D;
     };
 };
 
@@ -15,11 +15,16 @@
     You should have received a copy of the GNU Lesser General Public License
     along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <memory>
+#include <glm/vec2.hpp>
 #include "mesh/mesh.h"
 #include "mesh/command.h"
 #include "settings/settings.h"
 #include "geometric/binPacking.h"
+#include "geometric/nesting.h"
 #include "geometric/obbox.h"
+#include "threading/parallelfor.h"
+#include "io/loadprogress.h"
 
 using glm::vec2;
 using glm::max;
@@ -28,10 +33,13 @@ using glm::sqrt;
 namespace
 {
 const float groupGap = 0.5f;
+//groups with more convex pieces are nested by their convex hulls
+const std::size_t maxNestingPieces = 32;
 
 struct SGroupBBox : SAABBox2D
 {
     vec2 grpCenter;
+    float rotation; //applied on top of group's current rotation
     CMesh::STriGroup* grp;
 
     vec2 GetFinalPosition() const
@@ -74,21 +82,104 @@ private:
     int y;
 };
 
+std::unique_ptr<BinPacking::IBinPacker> CreateBinPacker(CSettings::PackingAlgorithm algorithm)
+{
+    switch(algorithm)
+    {
+    case CSettings::PA_FCNR:
+        return std::unique_ptr<BinPacking::IBinPacker>(new BinPacking::CFCNRPacker());
+    case CSettings::PA_SKYLINE:
+        return std::unique_ptr<BinPacking::IBinPacker>(new BinPacking::CSkylinePacker());
+    case CSettings::PA_MAXRECTS:
+    default:
+        return std::unique_ptr<BinPacking::IBinPacker>(new BinPacking::CMaxRectsPacker());
+    }
+}
+
+struct SGroupPlacement
+{
+    std::size_t sheet = BinPacking::notPacked;
+    vec2        position; //of the group, relative to sheet's printable area
+};
+
+std::vector<SGroupPlacement> PackBoxes(std::vector<SGroupBBox>& bboxes, CSettings::PackingAlgorithm algorithm, float binWidth, float binHeight)
+{
+    std::vector<SAABBox2D*> bboxPtrs;
+    bboxPtrs.reserve(bboxes.size());
+    for(auto& bbox : bboxes)
+        bboxPtrs.push_back(&bbox);
+
+    std::unique_ptr<BinPacking::IBinPacker> packer = CreateBinPacker(algorithm);
+    const std::vector<BinPacking::SPlacement> packed = packer->Pack(bboxPtrs, binWidth, binHeight);
+
+    std::vector<SGroupPlacement> placements(bboxes.size());
+    for(std::size_t i=0; i<bboxes.size(); ++i)
+    {
+        SGroupBBox& b = bboxes[i];
+        if(packed[i].bin == BinPacking::notPacked)
+            continue;
+        //packer may turn box by 90 degrees, group's center has to be found for the final orientation
+        if(packed[i].rotated)
+        {
+            b.rotation += 90.0f;
+            b.grpCenter = b.grp->GetAABBoxForRotation(b.grp->GetRotation() + b.rotation).position;
+        }
+        placements[i].sheet = packed[i].bin;
+        placements[i].position = b.GetFinalPosition();
+    }
+    return placements;
+}
+
+std::vector<SGroupPlacement> NestGroups(std::vector<SGroupBBox>& bboxes, float binWidth, float binHeight)
+{
+    //outlines are tried in 4 orientations, starting with the one of minimal bounding box
+    std::vector<Nesting::SPart> parts(bboxes.size());
+    ParallelFor(bboxes.size(), 4, [&bboxes, &parts](std::size_t begin, std::size_t end)
+    {
+        std::vector<vec2> vertices;
+        for(std::size_t i=begin; i<end; ++i)
+        {
+            const CMesh::STriGroup& grp = *bboxes[i].grp;
+            for(int quarter=0; quarter<4; ++quarter)
+            {
+                grp.GetVerticesForRotation(grp.GetRotation() + bboxes[i].rotation + quarter * 90.0f, vertices);
+                parts[i].orientations.push_back(Nesting::GetConvexPieces(vertices, maxNestingPieces));
+            }
+        }
+    });
+
+    const std::vector<Nesting::SPlacement> nested = Nesting::Nest(parts, binWidth, binHeight, groupGap);
+
+    std::vector<SGroupPlacement> placements(bboxes.size());
+    for(std::size_t i=0; i<bboxes.size(); ++i)
+    {
+        if(nested[i].bin == BinPacking::notPacked)
+            continue;
+        bboxes[i].rotation += nested[i].orientation * 90.0f;
+        placements[i].sheet = nested[i].bin;
+        placements[i].position = bboxes[i].grp->GetPosition() + nested[i].offset;
+    }
+    return placements;
+}
+
+//computed from local coordinates, cached world data of triangles is not touched, so groups may be evaluated in parallel
 SOBBox GetGroupOBBox(const CMesh::STriGroup& group, std::function<float(const SAABBox2D&)> price)
 {
-    const auto& tris = group.GetTriangles();
     std::vector<vec2> points;
-    points.reserve(tris.size()*3);
-    for(const auto* triangle : tris)
-        for(int i=0; i<3; i++)
-            points.push_back((*triangle)[i] - group.GetPosition()); //subtract position to prevent integer overflow in algorithm
+    group.GetVerticesForRotation(group.GetRotation(), points);
+    const vec2 position = group.GetPosition();
+    for(vec2& point : points)
+        point -= position; //subtract position to prevent integer overflow in algorithm
     return GetMinOBBox(points, price);
 }
 
 } //namespace anonymous
 
-bool CMesh::PackGroups(bool undoable)
+bool CMesh::PackGroups(bool undoable, CLoadProgress* progress)
 {
+    CLoadProgress noProgress;
+    CLoadProgress& prog = progress ? *progress : noProgress;
+
     CSettings& sett = CSettings::GetInstance();
     const float marginsH = static_cast<float>(sett.GetMarginsHorizontal())*0.1f;
     const float marginsV = static_cast<float>(sett.GetMarginsVertical())*0.1f;
@@ -109,83 +200,108 @@ bool CMesh::PackGroups(bool undoable)
         return b.height;
     };
 
-    std::unique_ptr<CIvoCommand> cmd(new CIvoCommand());
-    CIvoCommand rotationCommand;
-
-    std::vector<std::unique_ptr<SAABBox2D>> bboxes;
+    //orientation of every group is a pure function of its triangles, so groups are evaluated in parallel
+    struct SGroupOrientation
+    {
+        float     rotation;
+        SAABBox2D box;
+    };
+    std::vector<STriGroup*> groups;
+    groups.reserve(m_groups.size());
     for(auto& grp : m_groups)
+        groups.push_back(&grp);
+    std::vector<SGroupOrientation> orientations(groups.size());
+    prog.BeginStage(CLoadProgress::S_PACKING, groups.size());
+    ParallelFor(groups.size(), 8, [&groups, &orientations, &bboxPrice, &prog](std::size_t begin, std::size_t end)
     {
-        const SOBBox groupOOBBox = GetGroupOBBox(grp, bboxPrice);
+        for(std::size_t i=begin; i<end; ++i)
+        {
+            prog.Advance();
+            const STriGroup& grp = *groups[i];
+            const SOBBox groupOOBBox = GetGroupOBBox(grp, bboxPrice);
+            orientations[i].rotation = -groupOOBBox.GetRotation();
+            orientations[i].box = grp.GetAABBoxForRotation(grp.GetRotation() + orientations[i].rotation);
+        }
+    });
 
-        float rotationAngle = -groupOOBBox.GetRotation();
+    std::unique_ptr<CTransformCommand> cmd(new CTransformCommand());
 
-        CAtomicCommand cmdRot(CT_ROTATE);
-        cmdRot.SetTriangle(grp.m_tris.front());
-        cmdRot.SetRotation(rotationAngle);
-        cmdRot.Redo();
+    std::vector<SGroupBBox> bboxes;
+    bboxes.reserve(groups.size());
+    for(std::size_t i=0; i<groups.size(); ++i)
+    {
+        STriGroup& grp = *groups[i];
+        const SGroupOrientation& orientation = orientations[i];
 
-        const float boxWidth = grp.m_toRightDown.x - grp.m_toTopLeft.x + groupGap*2.0f;
-        const float boxHeight = grp.m_toTopLeft.y - grp.m_toRightDown.y + groupGap*2.0f;
+        const float boxWidth = orientation.box.width + groupGap*2.0f;
+        const float boxHeight = orientation.box.height + groupGap*2.0f;
         if(boxWidth > binWidth || boxHeight > binHeight)
         {
-            cmdRot.Undo();
             const SAABBox2D grpBBox = grp.GetAABBox();
-            const glm::vec2 grpCenter(grp.m_toRightDown.x*0.5f + grp.m_toTopLeft.x*0.5f,
-                                      grp.m_toTopLeft.y*0.5f   + grp.m_toRightDown.y*0.5f);
+            const glm::vec2 grpCenter = grpBBox.position;
             const glm::vec2 grpPos = grp.GetPosition();
             const glm::vec2 centerOffset(grpPos.x - grpCenter.x, grpPos.y - grpCenter.y);
-            CAtomicCommand cmdMoveAway(CT_MOVE);
-            cmdMoveAway.SetTriangle(grp.m_tris.front());
-            cmdMoveAway.SetTranslation(glm::vec2(-grpBBox.width*0.5f - groupGap, -grpBBox.height*0.5f) + centerOffset - grp.GetPosition());
-            cmd->AddAction(cmdMoveAway);
+            const glm::vec2 awayPos = glm::vec2(-grpBBox.width*0.5f - groupGap, -grpBBox.height*0.5f) + centerOffset;
+            cmd->AddGroup(&grp, grpPos, grp.GetRotation(), awayPos, grp.GetRotation());
 
             allPacked = false;
             continue;
         }
 
-        rotationCommand.AddAction(cmdRot);
-
-        SGroupBBox* bbox = new SGroupBBox();
-        bbox->grp = &grp;
-        bbox->width = boxWidth;
-        bbox->height = boxHeight;
-        bbox->grpCenter = (grp.m_toRightDown + grp.m_toTopLeft) * 0.5f;;
-        bboxes.emplace_back(bbox);
+        bboxes.emplace_back();
+        SGroupBBox& bbox = bboxes.back();
+        bbox.grp = &grp;
+        bbox.width = boxWidth;
+        bbox.height = boxHeight;
+        bbox.grpCenter = orientation.box.position;
+        bbox.rotation = orientation.rotation;
     }
 
-    rotationCommand.undo();
-    cmd->AddAction(std::move(rotationCommand));
+    prog.Check();
+    //all sheets are filled in one pass
+    const std::vector<SGroupPlacement> placements = sett.GetPackingAlgorithm() == CSettings::PA_NESTING ?
+                                                    NestGroups(bboxes, binWidth, binHeight) :
+                                                    PackBoxes(bboxes, sett.GetPackingAlgorithm(), binWidth, binHeight);
 
-    std::size_t prevSize = bboxes.size() + 1;
+    std::size_t sheetsUsed = 0;
+    for(const auto& placement : placements)
+        if(placement.sheet != BinPacking::notPacked)
+            sheetsUsed = std::max(sheetsUsed, placement.sheet + 1);
+
+    std::vector<glm::ivec2> sheets;
+    sheets.reserve(sheetsUsed);
     SPaperDispencer paperDispencer;
-    while(prevSize != bboxes.size())
+    for(std::size_t i=0; i<sheetsUsed; ++i)
     {
-        prevSize = bboxes.size();
-        std::vector<std::unique_ptr<SAABBox2D>> packed = BinPacking::PackFCNR(bboxes, binWidth, binHeight);
+        sheets.emplace_back(paperDispencer.GetX(), paperDispencer.GetY());
+        paperDispencer.NextSheet();
+    }
 
-        for(auto& boxPtr : packed)
+    for(std::size_t i=0; i<bboxes.size(); ++i)
+    {
+        const SGroupBBox& b = bboxes[i];
+        if(placements[i].sheet == BinPacking::notPacked)
         {
-            SGroupBBox& b = static_cast<SGroupBBox&>(*boxPtr);
-            vec2 finalPos = b.GetFinalPosition();
-            finalPos.x += paperDispencer.GetX() * papWidth + marginsH;
-            finalPos.y -= (paperDispencer.GetY() + 1) * papHeight - marginsV;
-
-            CAtomicCommand cmdMov(CT_MOVE);
-            cmdMov.SetTriangle(b.grp->m_tris.front());
-            cmdMov.SetTranslation(finalPos - b.grp->GetPosition());
-            cmd->AddAction(cmdMov);
+            cmd->AddGroup(b.grp, b.grp->GetPosition(), b.grp->GetRotation(), b.grp->GetPosition(), b.grp->GetRotation() + b.rotation);
+            allPacked = false;
+            continue;
         }
 
-        paperDispencer.NextSheet();
+        const glm::ivec2& sheet = sheets[placements[i].sheet];
+        vec2 finalPos = placements[i].position;
+        finalPos.x += sheet.x * papWidth + marginsH;
+        finalPos.y -= (sheet.y + 1) * papHeight - marginsV;
+
+        cmd->AddGroup(b.grp, b.grp->GetPosition(), b.grp->GetRotation(), finalPos, b.grp->GetRotation() + b.rotation);
     }
 
     if(undoable)
     {
-        m_undoStack.push(cmd.release());
+        PushCommand(cmd.release());
     } else {
         cmd->redo();
-        m_undoStack.clear();
+        m_undoStack.Clear();
     }
 
-    return allPacked && bboxes.empty();
+    return allPacked;
 }
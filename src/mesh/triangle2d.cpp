@@ -42,67 +42,36 @@ using glm::transformation;
 using glm::rightTurn;
 using glm::leftTurn;
 
-void CMesh::SEdge::NextFlapPosition()
+CMesh::STriangle2D* CMesh::SEdge::GetOtherTriangle(const STriangle2D *aFirstTri) const
 {
-    switch(m_flapPosition)
-    {
-        case FP_LEFT :
-        m_flapPosition = FP_RIGHT; break;
-
-        case FP_RIGHT :
-        m_flapPosition = FP_BOTH; break;
-
-        case FP_BOTH :
-        m_flapPosition = FP_NONE; break;
-
-        case FP_NONE :
-        m_flapPosition = FP_LEFT; break;
-
-    default : break;
-    }
+    CMesh* mesh = aFirstTri->m_myGroup->m_mesh;
+    const std::uint32_t other = GetOtherTriangle(mesh->IndexOf(aFirstTri));
+    return (other == NO_INDEX ?
+            nullptr :
+            &mesh->m_tri2D[other]);
 }
 
-CMesh::STriangle2D* CMesh::SEdge::GetOtherTriangle(const STriangle2D *aFirstTri) const
+std::uint32_t CMesh::SEdge::GetOtherTriangle(std::uint32_t firstTri) const
 {
-    return (m_left == aFirstTri ?
+    return (m_left == firstTri ?
             m_right :
             m_left);
 }
 
-void CMesh::SEdge::SetSnapped(bool snapped)
-{
-    m_snapped = snapped;
-}
-
 int CMesh::SEdge::GetOtherTriIndex(const STriangle2D *aFirstTri) const
 {
-    return (m_left == aFirstTri ?
+    return (m_left == aFirstTri->m_myGroup->m_mesh->IndexOf(aFirstTri) ?
             m_rightIndex :
             m_leftIndex);
 }
 
-CMesh::STriangle2D* CMesh::SEdge::GetAnyTriangle() const
-{
-    return (m_left == nullptr ?
-            m_right :
-            m_left);
-}
-
 int CMesh::SEdge::GetAnyTriIndex() const
 {
-    return (m_left == nullptr ?
+    return (m_left == NO_INDEX ?
             m_rightIndex :
             m_leftIndex);
 }
 
-CMesh::STriangle2D* CMesh::SEdge::GetTriangle(size_t index) const
-{
-    assert(index < 2);
-    return (index == 0 ?
-            m_left :
-            m_right);
-}
-
 int CMesh::SEdge::GetTriIndex(size_t index) const
 {
     assert(index < 2);
@@ -126,7 +95,7 @@ CMesh::SEdge::EFoldType CMesh::SEdge::GetFoldType() const
     return m_foldType;
 }
 
-void CMesh::STriangle2D::GroupHasTransformed(const mat3 &parMx)
+mat3 CMesh::STriangle2D::GetTransformedMatrix(const mat3 &parMx) const
 {
     mat3 newMx = parMx * m_relativeMx;
 
@@ -135,6 +104,28 @@ void CMesh::STriangle2D::GroupHasTransformed(const mat3 &parMx)
     newMx[1][0] = clamp(newMx[1][0], -1.0f, 1.0f);
     newMx[1][1] = clamp(newMx[1][1], -1.0f, 1.0f);
     newMx[0][1] = clamp(newMx[0][1], -1.0f, 1.0f);
+    return newMx;
+}
+
+void CMesh::STriangle2D::GetTransformedVertices(const mat3 &parMx, vec2 (&vertices)[3]) const
+{
+    const mat3 newMx = GetTransformedMatrix(parMx);
+    const vec2 position(newMx[2][0], newMx[2][1]);
+    mat2 rotMx;
+    rotMx[0] = vec2(newMx[0][0], newMx[0][1]);
+    rotMx[1] = vec2(newMx[1][0], newMx[1][1]);
+    for(int i=0; i<3; ++i)
+        vertices[i] = rotMx*m_vtx[i]+position;
+}
+
+//moving or rotating group is O(1), triangles catch up when their world data is requested
+void CMesh::STriangle2D::UpdateWorldData() const
+{
+    if(!m_myGroup || m_transformRevision == m_myGroup->m_transformRevision)
+        return;
+    m_transformRevision = m_myGroup->m_transformRevision;
+
+    const mat3 newMx = GetTransformedMatrix(m_myGroup->m_matrix);
 
     m_position = vec2(newMx[2][0], newMx[2][1]);
     mat2 rotMx;
@@ -149,13 +140,36 @@ void CMesh::STriangle2D::GroupHasTransformed(const mat3 &parMx)
     }
 }
 
+const vec2& CMesh::STriangle2D::GetRotatedVertex(size_t index) const
+{
+    assert(index < 3);
+    UpdateWorldData();
+    return m_vtxR[index];
+}
+
+const vec2& CMesh::STriangle2D::GetPosition() const
+{
+    UpdateWorldData();
+    return m_position;
+}
+
+float CMesh::STriangle2D::GetRotation() const
+{
+    UpdateWorldData();
+    return m_rotation;
+}
+
+//world data is considered to be up to date with current group's transform
 void CMesh::STriangle2D::SetRelMx(mat3 &invParentMx)
 {
+    if(m_myGroup)
+        m_transformRevision = m_myGroup->m_transformRevision;
     m_relativeMx = invParentMx * GetMatrix();
 }
 
 mat3 CMesh::STriangle2D::GetMatrix() const
 {
+    UpdateWorldData();
     float rotRAD = radians(m_rotation);
     mat3 mx = transformation(m_position, rotRAD);
     return mx;
@@ -163,6 +177,7 @@ mat3 CMesh::STriangle2D::GetMatrix() const
 
 void CMesh::STriangle2D::Scale(const float scale)
 {
+    UpdateWorldData();
     for(int i=0; i<3; ++i)
     {
         m_vtx[i] *= scale;
@@ -216,6 +231,8 @@ void CMesh::STriangle2D::SetPosition(vec2 pos)
 
 bool CMesh::STriangle2D::Intersect(const STriangle2D &other) const
 {
+    UpdateWorldData();
+    other.UpdateWorldData();
     for(int i=0; i<3; ++i)
     for(int j=0; j<3; ++j)
         if(EdgesIntersect(m_vtxRT[i], m_vtxRT[(i+1)%3], other.m_vtxRT[j], other.m_vtxRT[(j+1)%3]))
@@ -225,6 +242,7 @@ bool CMesh::STriangle2D::Intersect(const STriangle2D &other) const
 
 bool CMesh::STriangle2D::PointInside(const vec2 &point) const
 {
+    UpdateWorldData();
     for(int i=0; i<3; ++i)
     {
         const vec2 vB = point - m_vtxRT[i];
@@ -237,6 +255,7 @@ bool CMesh::STriangle2D::PointInside(const vec2 &point) const
 
 bool CMesh::STriangle2D::PointIsNearEdge(const vec2 &point, const int &i, float &score) const
 {
+    UpdateWorldData();
     float dv[2] = { distance(point, m_vtxRT[i]),
                     distance(point, m_vtxRT[(i+1)%3]) };
 
@@ -259,6 +278,7 @@ float CMesh::STriangle2D::GetEdgeLen(size_t index) const
 const vec2& CMesh::STriangle2D::operator[](size_t index) const
 {
     assert(index < 3);
+    UpdateWorldData();
     return m_vtxRT[index];
 }
 
@@ -280,13 +300,14 @@ bool CMesh::STriangle2D::IsFlapSharp(size_t index) const
 
 CMesh::SEdge* CMesh::STriangle2D::GetEdge(size_t index) const
 {
-    assert(index < 3);
-    return m_edges[index];
+    assert(index < 3 && m_myGroup);
+    return &m_myGroup->m_mesh->m_edges[m_edges[index]];
 }
 
 const vec2& CMesh::STriangle2D::GetNormal(size_t index) const
 {
     assert(index < 3);
+    UpdateWorldData();
     return m_normR[index];
 }
 
@@ -329,6 +350,7 @@ bool CMesh::STriangle2D::EdgesIntersect(const vec2 &e1v1, const vec2 &e1v2, cons
 
 QJsonObject CMesh::STriangle2D::Serialize() const
 {
+    UpdateWorldData();
     QJsonObject tri2DObject;
     tri2DObject.insert("id", ToJSON(m_id));
     tri2DObject.insert("vertexInitial", ToJSON(m_vtx));
@@ -21,6 +21,8 @@
 #include <stdexcept>
 #include <unordered_set>
 #include <limits>
+#include <cmath>
+#include <glm/common.hpp>
 #include <glm/geometric.hpp>
 #include <glm/trigonometric.hpp>
 #include <glm/gtx/norm.hpp>
@@ -36,6 +38,10 @@ using glm::vec2;
 using glm::vec3;
 using glm::sin;
 using glm::cos;
+using glm::acos;
+using glm::asin;
+using glm::sign;
+using glm::degrees;
 using glm::min;
 using glm::max;
 using glm::radians;
@@ -44,23 +50,112 @@ using glm::inverse;
 using glm::distance2;
 using glm::transformation;
 
-float CMesh::STriGroup::ms_depthStep = 1.0f;
+std::atomic<std::uint64_t> CMesh::STriGroup::ms_revisionCounter(0);
+std::atomic<std::uint64_t> CMesh::STriGroup::ms_visitEpoch(0);
 
-CMesh::STriGroup::STriGroup() :
+CMesh::STriGroup::STriGroup(CMesh* mesh) :
+    m_mesh(mesh),
+    m_aabbHSide(0.0f),
     m_position(vec2(0.0f,0.0f)),
     m_rotation(0.0f),
-    m_matrix(1)
+    m_matrix(1),
+    m_triTreeValid(false),
+    m_triTreeOffset(0.0f, 0.0f),
+    m_sceneTree(nullptr),
+    m_sceneProxy(CAABBTree2D::NullNode),
+    m_revision(++ms_revisionCounter),
+    m_transformRevision(++ms_revisionCounter),
+    m_batchRevision(0),
+    m_worldRevision(0)
 {
+    ResetBBoxVectors();
+}
+
+CMesh::STriGroup::~STriGroup()
+{
+    if(m_sceneTree)
+        m_sceneTree->Remove(m_sceneProxy);
+}
+
+void CMesh::STriGroup::AttachToScene(CAABBTree2D* sceneTree)
+{
+    if(m_sceneTree)
+        m_sceneTree->Remove(m_sceneProxy);
+    m_sceneTree = sceneTree;
+    m_sceneProxy = m_sceneTree->Insert(GetSceneBBox(), this);
+}
+
+//square around group's origin does not depend on rotation, so it can be updated in O(1)
+SAABBox2D CMesh::STriGroup::GetSceneBBox() const
+{
+    return SAABBox2D(m_position + vec2(m_aabbHSide, -m_aabbHSide),
+                     m_position + vec2(-m_aabbHSide, m_aabbHSide));
+}
+
+//keeps group's node in the scene tree in sync with its bounding square
+void CMesh::STriGroup::UpdateSceneProxy()
+{
+    if(m_sceneTree)
+        m_sceneTree->Move(m_sceneProxy, GetSceneBBox());
+}
+
+//revisions are unique across groups, so a new group never matches a stale one
+void CMesh::STriGroup::Modified()
+{
+    m_revision = ++ms_revisionCounter;
+}
+
+//triangles compare this against their own revision to know if their world data is stale
+void CMesh::STriGroup::Transformed()
+{
+    m_transformRevision = ++ms_revisionCounter;
+}
+
+void CMesh::STriGroup::UpdateWorldData() const
+{
+    if(m_worldRevision == m_transformRevision)
+        return;
+
+    if(m_batchRevision != m_revision)
+    {
+        m_batch.Clear();
+        m_batch.Reserve(m_tris.size());
+        for(const STriangle2D* t : GetTriangles())
+            m_batch.Add(t->m_relativeMx, t->m_vtx, t->m_norm);
+        m_batchRevision = m_revision;
+    }
+    m_batch.Transform(m_matrix);
+
+    std::size_t i = 0;
+    for(const STriangle2D* t : GetTriangles())
+    {
+        if(t->m_transformRevision != m_transformRevision)
+        {
+            t->m_position = m_batch.GetPosition(i);
+            t->m_rotation = m_batch.GetRotation(i);
+            for(int v=0; v<3; ++v)
+            {
+                t->m_vtxR[v] = m_batch.GetRotatedVertex(i, v);
+                t->m_vtxRT[v] = m_batch.GetTransformedVertex(i, v);
+                t->m_normR[v] = m_batch.GetRotatedNormal(i, v);
+            }
+            t->m_transformRevision = m_transformRevision;
+        }
+        ++i;
+    }
+    m_worldRevision = m_transformRevision;
 }
 
 bool CMesh::STriGroup::AddTriangle(STriangle2D* tr, STriangle2D* referal)
 {
     if(referal == nullptr)
     {
-        m_tris.push_front(tr);
+        tr->UpdateWorldData();
+        m_tris.push_back(m_mesh->IndexOf(tr));
         tr->m_myGroup = this;
         mat3 id(1);
         tr->SetRelMx(id);
+        InsertToTriangleTree(tr);
         for(int v=0; v<3; ++v)
         {
             const vec2 &vert = tr->m_vtxRT[v];
@@ -69,47 +164,54 @@ bool CMesh::STriGroup::AddTriangle(STriangle2D* tr, STriangle2D* referal)
             m_toRightDown[0] = max(m_toRightDown[0], vert[0]);
             m_toRightDown[1] = min(m_toRightDown[1], vert[1]);
         }
+        Modified();
         return true;
     }
     if(tr->m_myGroup == referal->m_myGroup)
         return false;
 
     //find adjacent edges
+    std::vector<SEdge>& edges = m_mesh->m_edges;
+    const std::uint32_t trInd = m_mesh->IndexOf(tr);
+    const std::uint32_t referalInd = m_mesh->IndexOf(referal);
     int e1=-1, e2=-1;
     for(int i=0; i<3; ++i)
     {
-        if(tr->m_edges[i]->m_left == referal ||
-           tr->m_edges[i]->m_right == referal)
+        if(edges[tr->m_edges[i]].m_left == referalInd ||
+           edges[tr->m_edges[i]].m_right == referalInd)
             e1 = i;
-        if(referal->m_edges[i]->m_left == tr ||
-           referal->m_edges[i]->m_right == tr)
+        if(edges[referal->m_edges[i]].m_left == trInd ||
+           edges[referal->m_edges[i]].m_right == trInd)
             e2 = i;
     }
     assert(e1 > -1 && e2 > -1);
     STriangle2D backup = *tr;
     //rotate and translate tr to match referal's edge
-    float trNewRotation = referal->m_rotation + 180.0f + tr->m_angleOY[e1] - referal->m_angleOY[e2];
+    float trNewRotation = referal->GetRotation() + 180.0f + tr->m_angleOY[e1] - referal->m_angleOY[e2];
     tr->SetRotation(trNewRotation);
-    vec2 trNewPosition = referal->m_position - tr->m_vtxR[e1] + referal->m_vtxR[(e2+1)%3];
+    vec2 trNewPosition = referal->GetPosition() - tr->m_vtxR[e1] + referal->GetRotatedVertex((e2+1)%3);
     tr->SetPosition(trNewPosition);
 
     //now check if tr overlaps any triangle in group
-    for(auto it=m_tris.begin(); it!=m_tris.end(); ++it)
+    bool overlaps = false;
+    GetTriangleTree().Query(GetTriangleTreeBBox(*tr), [this, tr, referal, &overlaps](int proxy)
     {
-        STriangle2D *toCheck = *it;
-        if(toCheck == referal)
-            continue;
-        if(toCheck->Intersect(*tr))
-        {
-            *tr = backup; //cancel changes
-            return false;
-        }
+        const STriangle2D *toCheck = static_cast<const STriangle2D*>(m_triTree.GetUserData(proxy));
+        if(toCheck != referal && toCheck->Intersect(*tr))
+            overlaps = true;
+        return !overlaps;
+    });
+    if(overlaps)
+    {
+        *tr = backup; //cancel changes
+        return false;
     }
-    tr->m_edges[e1]->m_snapped = true;
-    m_tris.push_front(tr);
+    edges[tr->m_edges[e1]].m_snapped = true;
+    m_tris.push_back(trInd);
+    tr->m_myGroup = this;
     mat3 id(1);
     tr->SetRelMx(id);
-    tr->m_myGroup = this;
+    InsertToTriangleTree(tr);
     for(int v=0; v<3; ++v)
     {
         const vec2 &vert = tr->m_vtxRT[v];
@@ -118,26 +220,28 @@ bool CMesh::STriGroup::AddTriangle(STriangle2D* tr, STriangle2D* referal)
         m_toRightDown[0] = max(m_toRightDown[0], vert[0]);
         m_toRightDown[1] = min(m_toRightDown[1], vert[1]);
     }
+    Modified();
 
     //check if other edges can be snapped
     for(int i=0; i<3; i++)
     {
         if(e1 == i)
             continue;
-        if(!tr->m_edges[i]->HasTwoTriangles())
+        SEdge& edge = edges[tr->m_edges[i]];
+        if(!edge.HasTwoTriangles())
             continue;
 
-        STriangle2D* otherTri = tr->m_edges[i]->GetOtherTriangle(tr);
+        const STriangle2D* otherTri = &m_mesh->m_tri2D[edge.GetOtherTriangle(trInd)];
 
         if(tr->GetGroup() != otherTri->GetGroup())
             continue;
 
-        int i2 = tr->m_edges[i]->GetOtherTriIndex(tr);
+        int i2 = edge.GetOtherTriIndex(tr);
 
-        const vec2& tr1V2 = tr->m_vtxRT[i];
-        const vec2& tr1V1 = tr->m_vtxRT[(i+1)%3];
-        const vec2& tr2V1 = otherTri->m_vtxRT[i2];
-        const vec2& tr2V2 = otherTri->m_vtxRT[(i2+1)%3];
+        const vec2& tr1V2 = (*tr)[i];
+        const vec2& tr1V1 = (*tr)[(i+1)%3];
+        const vec2& tr2V1 = (*otherTri)[i2];
+        const vec2& tr2V2 = (*otherTri)[(i2+1)%3];
 
         static const float epsilon = 0.001f;
 
@@ -146,31 +250,93 @@ bool CMesh::STriGroup::AddTriangle(STriangle2D* tr, STriangle2D* referal)
            fabs(tr1V2.x - tr2V2.x) < epsilon &&
            fabs(tr1V2.y - tr2V2.y) < epsilon)
         {
-            tr->m_edges[i]->SetSnapped(true);
+            m_mesh->SetEdgeSnapped(edge, true);
         }
     }
     return true;
 }
 
-void CMesh::STriGroup::ResetBBoxVectors()
+void CMesh::STriGroup::ResetBBoxVectors() const
 {
     m_toTopLeft   = vec2(std::numeric_limits<float>::max(),    std::numeric_limits<float>::lowest());
     m_toRightDown = vec2(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::max());
+    m_bboxValid = true;
 }
 
-void CMesh::STriGroup::RecalcBBoxVectors()
+//vertices are transformed on the fly, triangles' world data is left untouched
+void CMesh::STriGroup::RecalcBBoxVectors() const
 {
     ResetBBoxVectors();
 
-    for(STriangle2D *t : m_tris)
-        for(int v=0; v<3; ++v)
+    for(const STriangle2D *t : GetTriangles())
+    {
+        vec2 vertices[3];
+        t->GetTransformedVertices(m_matrix, vertices);
+        for(const vec2& vert : vertices)
         {
-            const vec2 &vert = t->m_vtxRT[v];
             m_toTopLeft[0] = min(m_toTopLeft[0], vert[0]);
             m_toTopLeft[1] = max(m_toTopLeft[1], vert[1]);
             m_toRightDown[0] = max(m_toRightDown[0], vert[0]);
             m_toRightDown[1] = min(m_toRightDown[1], vert[1]);
         }
+    }
+}
+
+void CMesh::STriGroup::ValidateBBoxVectors() const
+{
+    if(!m_bboxValid)
+        RecalcBBoxVectors();
+}
+
+void CMesh::STriGroup::ResetTriangleTree()
+{
+    m_triTree.Clear();
+    m_triTreeOffset = vec2(0.0f, 0.0f);
+    m_triTreeValid = true;
+}
+
+//tree is not updated, if it is going to be rebuilt anyway
+void CMesh::STriGroup::InsertToTriangleTree(STriangle2D* tr)
+{
+    if(m_triTreeValid)
+        m_triTree.Insert(GetTriangleTreeBBox(*tr), tr);
+}
+
+const CAABBTree2D& CMesh::STriGroup::GetTriangleTree() const
+{
+    if(!m_triTreeValid)
+    {
+        m_triTree.Clear();
+        m_triTreeValid = true;
+        for(STriangle2D* t : GetTriangles())
+            m_triTree.Insert(GetTriangleTreeBBox(*t), t);
+    }
+    return m_triTree;
+}
+
+SAABBox2D CMesh::STriGroup::GetTriangleTreeBBox(const STriangle2D& tr) const
+{
+    const mat3 toLocal = inverse(m_matrix);
+    vec2 bMin(std::numeric_limits<float>::max());
+    vec2 bMax(std::numeric_limits<float>::lowest());
+    float maxEdgeLen = 0.0f;
+    for(int v=0; v<3; ++v)
+    {
+        const vec2 local = vec2(toLocal * vec3(tr[v], 1.0f)) - m_triTreeOffset;
+        bMin = min(bMin, local);
+        bMax = max(bMax, local);
+        maxEdgeLen = max(maxEdgeLen, tr.m_edgeLen[v]);
+    }
+    //box must contain area where STriangle2D::PointIsNearEdge succeeds, which is
+    //no further than 0.071 of edge length from the edge; also compensate rounding
+    //errors of transformation to local space
+    const vec2 pad = (bMax - bMin) * 0.001f + vec2(0.075f * maxEdgeLen + 0.00001f);
+    return SAABBox2D(vec2(bMax.x + pad.x, bMin.y - pad.y), vec2(bMin.x - pad.x, bMax.y + pad.y));
+}
+
+glm::vec2 CMesh::STriGroup::ToTriangleTreeSpace(const vec2& point) const
+{
+    return vec2(inverse(m_matrix) * vec3(point, 1.0f)) - m_triTreeOffset;
 }
 
 void CMesh::STriGroup::SetRotation(float angle)
@@ -183,10 +349,53 @@ void CMesh::STriGroup::SetRotation(float angle)
     float rotRAD = radians(m_rotation);
     m_matrix = transformation(m_matrix[2], rotRAD);
 
-    for(STriangle2D *t : m_tris)
-        t->GroupHasTransformed(m_matrix);
+    Transformed();
+    m_bboxValid = false;
+    UpdateSceneProxy();
+}
 
-    RecalcBBoxVectors();
+SAABBox2D CMesh::STriGroup::GetAABBoxForRotation(float angle) const
+{
+    const mat3 matrix = GetMatrixForRotation(angle);
+
+    vec2 topLeft(std::numeric_limits<float>::max(),    std::numeric_limits<float>::lowest());
+    vec2 rightDown(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::max());
+    for(const STriangle2D *t : GetTriangles())
+    {
+        vec2 vertices[3];
+        t->GetTransformedVertices(matrix, vertices);
+        for(const vec2& vert : vertices)
+        {
+            topLeft[0] = min(topLeft[0], vert[0]);
+            topLeft[1] = max(topLeft[1], vert[1]);
+            rightDown[0] = max(rightDown[0], vert[0]);
+            rightDown[1] = min(rightDown[1], vert[1]);
+        }
+    }
+    return SAABBox2D(rightDown, topLeft);
+}
+
+void CMesh::STriGroup::GetVerticesForRotation(float angle, std::vector<vec2>& vertices) const
+{
+    const mat3 matrix = GetMatrixForRotation(angle);
+
+    vertices.clear();
+    vertices.reserve(m_tris.size() * 3);
+    for(const STriangle2D *t : GetTriangles())
+    {
+        vec2 triVertices[3];
+        t->GetTransformedVertices(matrix, triVertices);
+        vertices.insert(vertices.end(), std::begin(triVertices), std::end(triVertices));
+    }
+}
+
+mat3 CMesh::STriGroup::GetMatrixForRotation(float angle) const
+{
+    while(angle >= 360.0f)
+        angle -= 360.0f;
+    while(angle < 0.0f)
+        angle += 360.0f;
+    return transformation(vec2(m_matrix[2]), radians(angle));
 }
 
 void CMesh::STriGroup::SetPosition(float x, float y)
@@ -197,31 +406,45 @@ void CMesh::STriGroup::SetPosition(float x, float y)
     m_toTopLeft.y += y - m_position.y;
     m_matrix[2][0] = m_position[0] = x;
     m_matrix[2][1] = m_position[1] = y;
-    for(STriangle2D *t : m_tris)
-    {
-        t->GroupHasTransformed(m_matrix);
-    }
+
+    Transformed();
+    UpdateSceneProxy();
+}
+
+void CMesh::STriGroup::SetTransform(const vec2& position, float angle)
+{
+    m_rotation = angle;
+    while(m_rotation >= 360.0f)
+        m_rotation -= 360.0f;
+    while(m_rotation < 0.0f)
+        m_rotation += 360.0f;
+    m_position = position;
+    m_matrix = transformation(m_position, radians(m_rotation));
+
+    Transformed();
+    m_bboxValid = false;
+    UpdateSceneProxy();
 }
 
 void CMesh::STriGroup::CentrateOrigin()
 {
     m_position = vec2(0.0f, 0.0f);
-    for(const auto tri : m_tris)
+    for(const auto tri : GetTriangles())
     {
         const STriangle2D& tr = *tri;
-        m_position += tr.m_vtxRT[0];
-        m_position += tr.m_vtxRT[1];
-        m_position += tr.m_vtxRT[2];
+        m_position += tr[0];
+        m_position += tr[1];
+        m_position += tr[2];
     }
     m_position /= m_tris.size() * 3;
 
     float aabbHSideSQR = 0.0f;
-    for(const auto tri : m_tris)
+    for(const auto tri : GetTriangles())
     {
         const STriangle2D& tr = *tri;
         for(int i=0; i<3; ++i)
         {
-            float distanceSQR = distance2(m_position, tr.m_vtxRT[i]);
+            float distanceSQR = distance2(m_position, tr[i]);
 
             if(distanceSQR > aabbHSideSQR)
                 aabbHSideSQR = distanceSQR;
@@ -229,69 +452,108 @@ void CMesh::STriGroup::CentrateOrigin()
     }
     m_aabbHSide = sqrt(aabbHSideSQR);
 
+    const mat3 oldMatrix = m_matrix;
     float rotRAD = radians(m_rotation);
     m_matrix = transformation(m_position, rotRAD);
     mat3 pinv = inverse(m_matrix);
 
-    for(STriangle2D *t : m_tris)
+    //origin moves without rotation, so triangle tree only gets shifted
+    const mat3 oldToNew = pinv * oldMatrix;
+    if(std::fabs(oldToNew[0][0] - 1.0f) < 0.0001f && std::fabs(oldToNew[0][1]) < 0.0001f)
+        m_triTreeOffset += vec2(oldToNew[2]);
+    else
+        m_triTreeValid = false;
+
+    for(STriangle2D *t : GetTriangles())
         t->SetRelMx(pinv);
+
+    UpdateSceneProxy();
+    Modified();
 }
 
-void CMesh::STriGroup::AttachGroup(STriangle2D* tr2, int e2)
+CMesh::STriGroup& CMesh::STriGroup::AttachGroup(STriangle2D* tr2, int e2)
 {
     NOTIFY(CMesh::GroupStructureChanging);
 
     assert(tr2 && e2 >= 0 && e2 <= 2);
-    const STriGroup* grp = tr2->m_myGroup;
 
-    m_tris.insert(m_tris.end(), grp->m_tris.begin(), grp->m_tris.end());
+    //smaller group is merged into the bigger one, so this group may be removed;
+    //callers must not touch it afterwards, commands find groups by triangles anyway
+    STriGroup* survivor = this;
+    STriGroup* absorbed = tr2->m_myGroup;
+    if(absorbed->m_tris.size() > survivor->m_tris.size())
+        std::swap(survivor, absorbed);
+
+    CMesh* mesh = m_mesh;
+    survivor->Absorb(*absorbed);
+    mesh->RemoveGroup(*absorbed);
+    return *survivor;
+}
 
-    for(STriangle2D*& t : m_tris)
+//origin of this group is kept, so only triangles of the other group are touched;
+//radius and bounding box are extended by them
+void CMesh::STriGroup::Absorb(STriGroup& other)
+{
+    mat3 pinv = inverse(m_matrix);
+    float aabbHSideSQR = m_aabbHSide * m_aabbHSide;
+    for(STriangle2D* t : other.GetTriangles())
+    {
+        //world data is pulled from the old group here
+        t->UpdateWorldData();
+        for(int i=0; i<3; ++i)
+            aabbHSideSQR = max(aabbHSideSQR, distance2(m_position, (*t)[i]));
         t->m_myGroup = this;
+        t->SetRelMx(pinv);
+        InsertToTriangleTree(t);
+    }
+    m_aabbHSide = sqrt(aabbHSideSQR);
 
-    RecalcBBoxVectors();
-    CentrateOrigin();
-
-    for(auto it = CMesh::g_Mesh->m_groups.begin(); it != CMesh::g_Mesh->m_groups.end(); ++it)
+    if(m_bboxValid && other.m_bboxValid)
     {
-        if(&(*it) == grp)
-        {
-            CMesh::g_Mesh->m_groups.erase(it);
-            break;
-        }
+        m_toTopLeft[0] = min(m_toTopLeft[0], other.m_toTopLeft[0]);
+        m_toTopLeft[1] = max(m_toTopLeft[1], other.m_toTopLeft[1]);
+        m_toRightDown[0] = max(m_toRightDown[0], other.m_toRightDown[0]);
+        m_toRightDown[1] = min(m_toRightDown[1], other.m_toRightDown[1]);
     }
-    CMesh::g_Mesh->UpdateGroupDepth();
+    else
+        m_bboxValid = false;
+
+    m_tris.insert(m_tris.end(), other.m_tris.begin(), other.m_tris.end());
+    other.m_tris.clear();
+
+    UpdateSceneProxy();
+    Modified();
 }
 
 CIvoCommand* CMesh::STriGroup::GetJoinEdgeCmd(STriangle2D *tr, int e)
 {
     assert(e >= 0 && e < 3 && tr);
-    if(!tr->m_edges[e]->HasTwoTriangles()) return nullptr;
+    if(!tr->GetEdge(e)->HasTwoTriangles()) return nullptr;
 
     //get triangle at the other side of edge 'e'
-    STriangle2D *tr2 = tr->m_edges[e]->GetOtherTriangle(tr);
+    STriangle2D *tr2 = tr->GetEdge(e)->GetOtherTriangle(tr);
 
     if(!tr2) return nullptr;
 
     //get index of the other side of edge 'e'
-    int e2 = tr->m_edges[e]->GetOtherTriIndex(tr);
+    int e2 = tr->GetEdge(e)->GetOtherTriIndex(tr);
 
     assert(e2 > -1);
 
     std::function<CIvoCommand*(STriangle2D*, STriangle2D*, int, int)>
-            getSnapCommand = [this](STriangle2D* tr, STriangle2D* tr2, int e, int e2) -> CIvoCommand*
+            getSnapCommand = [](STriangle2D* tr, STriangle2D* tr2, int e, int e2) -> CIvoCommand*
         {
             if(!tr || !tr2 || e < 0 || e2 < 0 || e > 2 || e2 > 2)
                 return nullptr;
             if(tr->GetGroup() != tr2->GetGroup())
                 return nullptr;
-            if(tr->m_edges[e]->IsSnapped())
+            if(tr->GetEdge(e)->IsSnapped())
                 return nullptr;
 
-            const vec2& tr1V2 = tr->m_vtxRT[e];
-            const vec2& tr1V1 = tr->m_vtxRT[(e+1)%3];
-            const vec2& tr2V1 = tr2->m_vtxRT[e2];
-            const vec2& tr2V2 = tr2->m_vtxRT[(e2+1)%3];
+            const vec2& tr1V2 = (*tr)[e];
+            const vec2& tr1V1 = (*tr)[(e+1)%3];
+            const vec2& tr2V1 = (*tr2)[e2];
+            const vec2& tr2V2 = (*tr2)[(e2+1)%3];
 
             static const float epsilon = 0.001f;
 
@@ -334,11 +596,11 @@ CIvoCommand* CMesh::STriGroup::GetJoinEdgeCmd(STriangle2D *tr, int e)
     cmdAtt.SetEdge(e);
 
     float oldrot = grp->m_rotation;
-    float newRotation = grp->m_rotation - tr2->m_rotation + tr2->m_angleOY[e2] + 180.0f - tr->m_angleOY[e] + tr->m_rotation;
+    float newRotation = grp->m_rotation - tr2->GetRotation() + tr2->m_angleOY[e2] + 180.0f - tr->m_angleOY[e] + tr->GetRotation();
     cmdRot.SetRotation(newRotation - grp->GetRotation());
     grp->SetRotation(newRotation);
 
-    vec2 newPos = tr->m_vtxRT[e] - tr2->m_vtxRT[(e2+1)%3]/*(mat2(matrix) * tr2->m_vtx[(e2+1)%3] + vec2(matrix[2][0], matrix[2][1]))*/ + grp->m_position;
+    vec2 newPos = (*tr)[e] - (*tr2)[(e2+1)%3]/*(mat2(matrix) * tr2->m_vtx[(e2+1)%3] + vec2(matrix[2][0], matrix[2][1]))*/ + grp->m_position;
     cmdMov.SetTranslation(newPos - grp->GetPosition());
     grp->SetRotation(oldrot);
 
@@ -352,14 +614,14 @@ CIvoCommand* CMesh::STriGroup::GetJoinEdgeCmd(STriangle2D *tr, int e)
     if(m_tris.size() > 1 || grp->m_tris.size() > 1)
     {
         //apply current command to update positions
-        cmd->redo();// 'grp' is no longer valid
+        cmd->redo();// 'grp' or this group may be removed, joined group is found through 'tr'
 
-        for(STriangle2D* tri : m_tris)
+        for(STriangle2D* tri : tr->m_myGroup->GetTriangles())
         {
             for(int e=0; e<3; e++)
             {
-                STriangle2D* tri2 = tri->m_edges[e]->GetOtherTriangle(tri);
-                int e2 = tri->m_edges[e]->GetOtherTriIndex(tri);
+                STriangle2D* tri2 = tri->GetEdge(e)->GetOtherTriangle(tri);
+                int e2 = tri->GetEdge(e)->GetOtherTriIndex(tri);
 
                 //check if triangles can be snapped
                 CIvoCommand* snapCmd = getSnapCommand(tri, tri2, e, e2);
@@ -382,18 +644,20 @@ CIvoCommand* CMesh::STriGroup::GetJoinEdgeCmd(STriangle2D *tr, int e)
 
 SAABBox2D CMesh::STriGroup::GetAABBox() const
 {
+    ValidateBBoxVectors();
     return SAABBox2D(m_toRightDown, m_toTopLeft);
 }
 
 void CMesh::STriGroup::JoinEdge(STriangle2D *tr, int e)
 {
+    //building the command joins and splits groups, so no member is read after it
+    CMesh* mesh = m_mesh;
     CIvoCommand* cmd = GetJoinEdgeCmd(tr, e);
 
     if(!cmd)
         return;
 
-    CMesh::g_Mesh->m_undoStack.push(cmd);
-    CMesh::g_Mesh->UpdateGroupDepth();
+    mesh->PushCommand(cmd);
 }
 
 void CMesh::STriGroup::BreakGroup(STriangle2D *tr2, int e2)
@@ -401,62 +665,40 @@ void CMesh::STriGroup::BreakGroup(STriangle2D *tr2, int e2)
     NOTIFY(CMesh::GroupStructureChanging);
 
     assert(tr2 && e2 >= 0 && e2 <= 2);
-    if(!tr2->m_edges[e2]->HasTwoTriangles()) return;
-
-    STriangle2D *tr = tr2->m_edges[e2]->GetOtherTriangle(tr2);
-    int e = tr2->m_edges[e2]->GetOtherTriIndex(tr2);
+    if(!tr2->GetEdge(e2)->HasTwoTriangles()) return;
 
+    STriangle2D *tr = tr2->GetEdge(e2)->GetOtherTriangle(tr2);
+    int e = tr2->GetEdge(e2)->GetOtherTriIndex(tr2);
 
     //all triangles, connected to tr without tr2
-    std::list<STriangle2D*> trAndCompany;
+    std::vector<STriangle2D*> trAndCompany;
+    if(!IsCutOff(tr, e, &trAndCompany))
+        return;
 
-    trAndCompany.push_back(tr);
-    std::unordered_set<STriangle2D*> currLevel; //of breadth-first search
-    for(int i=0; i<3; ++i)
-    {
-        if(i != e && tr->m_edges[i]->m_snapped && tr->m_edges[i]->HasTwoTriangles())
-        {
-            currLevel.insert(tr->m_edges[i]->GetOtherTriangle(tr));
-        }
-    }
-    while(!currLevel.empty())
-    {
-        std::unordered_set<STriangle2D*> nextLevel;
-        for(STriangle2D* t : currLevel)
-        {
-            for(int i=0; i<3; ++i)
-            {
-                STriangle2D *nbs = nullptr;
-                if(t->m_edges[i]->HasTwoTriangles())
-                    nbs = t->m_edges[i]->GetOtherTriangle(t);
-                if(nbs &&
-                   t->m_edges[i]->m_snapped &&
-                   currLevel.find(nbs) == currLevel.end() &&
-                   std::find(trAndCompany.begin(), trAndCompany.end(), nbs) == trAndCompany.end())
-                    nextLevel.insert(nbs);
-            }
-        }
-        trAndCompany.insert(trAndCompany.begin(), currLevel.begin(), currLevel.end());
-        currLevel = nextLevel;
-    }
+    const std::uint64_t keepEpoch = ++ms_visitEpoch;
+    for(STriangle2D* t : trAndCompany)
+        t->m_visitEpoch = keepEpoch;
 
-    CMesh::g_Mesh->m_groups.emplace_back();
-    STriGroup &newGroup = CMesh::g_Mesh->m_groups.back();
+    STriGroup &newGroup = m_mesh->CreateGroup();
 
     newGroup.ResetBBoxVectors();
-    for(STriangle2D*& t : m_tris)
+    newGroup.ResetTriangleTree();
+    for(STriangle2D* t : GetTriangles())
     {
-        if(std::find(trAndCompany.begin(), trAndCompany.end(), t) == trAndCompany.end())
+        if(t->m_visitEpoch != keepEpoch)
         {
             newGroup.AddTriangle(t, nullptr);
         }
     }
     newGroup.CentrateOrigin();
+    if(m_sceneTree)
+        newGroup.AttachToScene(m_sceneTree);
 
     ResetBBoxVectors();
+    ResetTriangleTree();
     m_tris.clear();
 
-    for(STriangle2D*& t : trAndCompany)
+    for(STriangle2D* t : trAndCompany)
     {
         AddTriangle(t, nullptr);
     }
@@ -467,55 +709,17 @@ void CMesh::STriGroup::BreakGroup(STriangle2D *tr2, int e2)
 CIvoCommand* CMesh::STriGroup::GetBreakEdgeCmd(STriangle2D *tr, int e)
 {
     assert(e >= 0 && e < 3 && tr);
-    if(!tr->m_edges[e]->HasTwoTriangles()) return nullptr;
+    if(!tr->GetEdge(e)->HasTwoTriangles()) return nullptr;
 
     //get triangle at the other side of edge 'e'
-    STriangle2D *tr2 = tr->m_edges[e]->GetOtherTriangle(tr);
+    STriangle2D *tr2 = tr->GetEdge(e)->GetOtherTriangle(tr);
     if(!tr2) return nullptr;
     //get index of the other side of edge 'e'
-    int e2 = tr->m_edges[e]->GetOtherTriIndex(tr);
+    int e2 = tr->GetEdge(e)->GetOtherTriIndex(tr);
     assert(e2 > -1);
 
-    //all triangles, connected to tr without tr2
-    std::list<STriangle2D*> trAndCompany;
-    trAndCompany.push_back(tr);
-
-    std::unordered_set<STriangle2D*> currLevel; //of breadth-first search
-    for(int i=0; i<3; ++i)
-    {
-        if(i != e && tr->m_edges[i]->m_snapped && tr->m_edges[i]->HasTwoTriangles())
-        {
-            currLevel.insert(tr->m_edges[i]->GetOtherTriangle(tr));
-        }
-    }
-
     //if cutOff == false, then we can reach tr2 from tr by series of edges without 'e', and we cannot split the group yet
-    bool cutOff = true;
-    while(!currLevel.empty())
-    {
-        std::unordered_set<STriangle2D*> nextLevel;
-        for(STriangle2D* t : currLevel)
-        {
-            for(int i=0; i<3; ++i)
-            {
-                STriangle2D *nbs = nullptr;
-                if(t->m_edges[i]->HasTwoTriangles())
-                    nbs = t->m_edges[i]->GetOtherTriangle(t);
-                if(nbs &&
-                   t->m_edges[i]->m_snapped &&
-                   currLevel.find(nbs) == currLevel.end() &&
-                   std::find(trAndCompany.begin(), trAndCompany.end(), nbs) == trAndCompany.end())
-                    nextLevel.insert(nbs);
-            }
-        }
-        if(nextLevel.find(tr2) != nextLevel.end())
-        {
-            cutOff = false;
-            break;
-        }
-        trAndCompany.insert(trAndCompany.begin(), currLevel.begin(), currLevel.end());
-        currLevel = nextLevel;
-    }
+    const bool cutOff = IsCutOff(tr, e, nullptr);
 
     CIvoCommand* cmd = new CIvoCommand();
 
@@ -535,15 +739,15 @@ CIvoCommand* CMesh::STriGroup::GetBreakEdgeCmd(STriangle2D *tr, int e)
         cmdMv1.SetTriangle(tr);
         cmdMv2.SetTriangle(tr2);
 
-        vec2 oldTRN = tr->m_normR[e];
-        vec2 oldTR2V0 = tr2->m_vtxRT[0];
-        vec2 oldTRV0 = tr->m_vtxRT[0];
+        vec2 oldTRN = tr->GetNormal(e);
+        vec2 oldTR2V0 = (*tr2)[0];
+        vec2 oldTRV0 = (*tr)[0];
 
-        STriGroup &newGroup = CMesh::g_Mesh->m_groups.back();
-        vec2 newPos = newGroup.m_position + oldTRN + oldTR2V0 - tr2->m_vtxRT[0];
+        STriGroup &newGroup = m_mesh->m_groups.back();
+        vec2 newPos = newGroup.m_position + oldTRN + oldTR2V0 - (*tr2)[0];
         cmdMv2.SetTranslation(newPos - newGroup.GetPosition());
 
-        newPos = m_position - oldTRN + oldTRV0 - tr->m_vtxRT[0];
+        newPos = m_position - oldTRN + oldTRV0 - (*tr)[0];
         cmdMv1.SetTranslation(newPos - GetPosition());
 
         cmd->AddAction(cmdBGrp);
@@ -554,24 +758,83 @@ CIvoCommand* CMesh::STriGroup::GetBreakEdgeCmd(STriangle2D *tr, int e)
     return cmd;
 }
 
+//searches from both sides of the edge 'e' of 'tr' by snapped edges at once, so the search stops as soon as
+//sides meet or the smaller side is exhausted; when group is cut off, triangles of tr's side are returned
+bool CMesh::STriGroup::IsCutOff(STriangle2D* tr, int e, std::vector<STriangle2D*>* trSide) const
+{
+    const std::vector<SEdge>& edges = m_mesh->m_edges;
+    std::vector<STriangle2D>& tris = m_mesh->m_tri2D;
+    const std::uint32_t cutEdge = tr->m_edges[e];
+    STriangle2D* tr2 = &tris[edges[cutEdge].GetOtherTriangle(m_mesh->IndexOf(tr))];
+
+    struct SSide
+    {
+        std::vector<STriangle2D*> visited;
+        std::size_t               next;
+        std::uint64_t             epoch;
+    };
+    SSide sides[2] = {{{tr}, 0, ++ms_visitEpoch}, {{tr2}, 0, ++ms_visitEpoch}};
+    tr->m_visitEpoch = sides[0].epoch;
+    tr2->m_visitEpoch = sides[1].epoch;
+
+    for(std::size_t current = 0; ; current ^= 1)
+    {
+        SSide& side = sides[current];
+        const std::uint64_t otherEpoch = sides[current ^ 1].epoch;
+
+        STriangle2D* t = side.visited[side.next++];
+        const std::uint32_t tInd = m_mesh->IndexOf(t);
+        for(int i=0; i<3; ++i)
+        {
+            const SEdge& edge = edges[t->m_edges[i]];
+            if(t->m_edges[i] == cutEdge || !edge.m_snapped || !edge.HasTwoTriangles())
+                continue;
+
+            STriangle2D* nbs = &tris[edge.GetOtherTriangle(tInd)];
+            if(nbs->m_visitEpoch == otherEpoch)
+                return false;
+            if(nbs->m_visitEpoch == side.epoch)
+                continue;
+            nbs->m_visitEpoch = side.epoch;
+            side.visited.push_back(nbs);
+        }
+
+        if(side.next == side.visited.size())
+        {
+            if(!trSide)
+                return true;
+
+            if(current == 0)
+            {
+                trSide->swap(side.visited);
+            } else {
+                trSide->clear();
+                trSide->reserve(m_tris.size() - side.visited.size());
+                for(STriangle2D* tri : GetTriangles())
+                    if(tri->m_visitEpoch != side.epoch)
+                        trSide->push_back(tri);
+            }
+            return true;
+        }
+    }
+}
+
 void CMesh::STriGroup::BreakEdge(STriangle2D *tr, int e)
 {
+    //building the command splits and joins groups, so no member is read after it
+    CMesh* mesh = m_mesh;
     CIvoCommand* cmd = GetBreakEdgeCmd(tr, e);
 
     if(!cmd)
         return;
 
-    CMesh::g_Mesh->m_undoStack.push(cmd);
-    CMesh::g_Mesh->UpdateGroupDepth();
+    mesh->PushCommand(cmd);
 }
 
 QJsonObject CMesh::STriGroup::Serialize() const
 {
-    assert(CMesh::g_Mesh);
-    std::vector<int> trInds(m_tris.size());
-    int i = 0;
-    for(const STriangle2D* tr : m_tris)
-        trInds[i++] = static_cast<int>(tr - &(CMesh::g_Mesh->m_tri2D[0]));
+    ValidateBBoxVectors();
+    const std::vector<int> trInds(m_tris.begin(), m_tris.end());
 
     QJsonObject grpObject;
     grpObject.insert("triangleIndices", ToJSON(trInds));
@@ -590,11 +853,11 @@ void CMesh::STriGroup::Deserialize(const QJsonObject& obj)
     FromJSON(obj["triangleIndices"], trInds);
     for(std::size_t i=0; i<trInds.size(); ++i)
     {
-        if(trInds[i] >= static_cast<int>(CMesh::g_Mesh->m_tri2D.size()))
+        if(trInds[i] < 0 || trInds[i] >= static_cast<int>(m_mesh->m_tri2D.size()))
             throw std::runtime_error("File corrupted: triangle index in group is out of range!");
 
-        m_tris.push_back(&(CMesh::g_Mesh->m_tri2D[trInds[i]]));
-        m_tris.back()->m_myGroup = this;
+        m_tris.push_back(static_cast<std::uint32_t>(trInds[i]));
+        m_mesh->m_tri2D[trInds[i]].m_myGroup = this;
     }
 
     FromJSON(obj["toTopLeft"], m_toTopLeft);
@@ -603,15 +866,18 @@ void CMesh::STriGroup::Deserialize(const QJsonObject& obj)
     FromJSON(obj["position"], m_position);
     FromJSON(obj["rotation"], m_rotation);
     FromJSON(obj["matrix"], m_matrix);
+    m_triTreeValid = false;
+    Modified();
 }
 
 void CMesh::STriGroup::Scale(const float scale)
 {
-    for(STriangle2D* tri : m_tris)
+    for(STriangle2D* tri : GetTriangles())
         tri->Scale(scale);
 
-    RecalcBBoxVectors();
+    m_triTreeValid = false;
     CentrateOrigin();
+    RecalcBBoxVectors();
 }
 
 const float& CMesh::STriGroup::GetDepth() const
@@ -619,9 +885,9 @@ const float& CMesh::STriGroup::GetDepth() const
     return m_depth;
 }
 
-float CMesh::STriGroup::GetDepthStep()
+float CMesh::STriGroup::GetDepthStep() const
 {
-    return ms_depthStep;
+    return m_mesh->m_depthStep;
 }
 
 const float& CMesh::STriGroup::GetAABBHalfSide() const
@@ -629,7 +895,7 @@ const float& CMesh::STriGroup::GetAABBHalfSide() const
     return m_aabbHSide;
 }
 
-const std::list<CMesh::STriangle2D*>& CMesh::STriGroup::GetTriangles() const
+CMesh::CTriangleRange CMesh::STriGroup::GetTriangles() const
 {
-    return m_tris;
+    return CTriangleRange(m_mesh->m_tri2D.data(), m_tris);
 }
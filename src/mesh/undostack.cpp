@@ -0,0 +1,110 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "mesh/undostack.h"
+#include "mesh/command.h"
+
+CUndoStack::CUndoStack(std::function<void()> onChanged) :
+    m_index(0),
+    m_memoryUsage(0),
+    m_memoryBudget(64u * 1024u * 1024u),
+    m_onChanged(std::move(onChanged))
+{
+}
+
+CUndoStack::~CUndoStack()
+{
+}
+
+void CUndoStack::Push(IMeshCommand* cmd)
+{
+    std::unique_ptr<IMeshCommand> command(cmd);
+    command->redo();
+
+    DropRedoable();
+    const std::size_t size = command->GetMemoryUsage();
+    m_commands.push_back(SEntry{std::move(command), size});
+    m_memoryUsage += size;
+    m_index = m_commands.size();
+    FitToBudget();
+
+    if(m_onChanged)
+        m_onChanged();
+}
+
+void CUndoStack::Undo()
+{
+    if(!CanUndo())
+        return;
+    m_commands[--m_index].command->undo();
+    if(m_onChanged)
+        m_onChanged();
+}
+
+void CUndoStack::Redo()
+{
+    if(!CanRedo())
+        return;
+    m_commands[m_index++].command->redo();
+    if(m_onChanged)
+        m_onChanged();
+}
+
+bool CUndoStack::CanUndo() const
+{
+    return m_index > 0;
+}
+
+bool CUndoStack::CanRedo() const
+{
+    return m_index < m_commands.size();
+}
+
+void CUndoStack::Clear()
+{
+    const bool wasEmpty = m_commands.empty();
+    m_commands.clear();
+    m_index = 0;
+    m_memoryUsage = 0;
+    if(!wasEmpty && m_onChanged)
+        m_onChanged();
+}
+
+void CUndoStack::SetMemoryBudget(std::size_t bytes)
+{
+    m_memoryBudget = bytes;
+    FitToBudget();
+}
+
+void CUndoStack::DropRedoable()
+{
+    while(m_commands.size() > m_index)
+    {
+        m_memoryUsage -= m_commands.back().size;
+        m_commands.pop_back();
+    }
+}
+
+void CUndoStack::FitToBudget()
+{
+    while(m_memoryUsage > m_memoryBudget && m_commands.size() > 1 && m_index > 0)
+    {
+        m_memoryUsage -= m_commands.front().size;
+        m_commands.pop_front();
+        --m_index;
+    }
+}
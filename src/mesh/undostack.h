@@ -0,0 +1,63 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef IVO_UNDO_STACK_H
+#define IVO_UNDO_STACK_H
+#include <deque>
+#include <memory>
+#include <functional>
+#include <cstddef>
+
+class IMeshCommand;
+
+//history of mesh commands, limited by memory they hold instead of their count
+class CUndoStack
+{
+public:
+    explicit CUndoStack(std::function<void()> onChanged);
+    ~CUndoStack();
+
+    //takes ownership and executes command; commands that could be redone are dropped
+    void        Push(IMeshCommand* cmd);
+    void        Undo();
+    void        Redo();
+    bool        CanUndo() const;
+    bool        CanRedo() const;
+    void        Clear();
+
+    //oldest commands are dropped while history takes more; the last command is always kept
+    void        SetMemoryBudget(std::size_t bytes);
+    std::size_t GetMemoryUsage() const { return m_memoryUsage; }
+
+private:
+    struct SEntry
+    {
+        std::unique_ptr<IMeshCommand> command;
+        std::size_t                   size;
+    };
+
+    void        DropRedoable();
+    void        FitToBudget();
+
+    std::deque<SEntry>    m_commands;
+    std::size_t           m_index; //commands before it are done
+    std::size_t           m_memoryUsage;
+    std::size_t           m_memoryBudget;
+    std::function<void()> m_onChanged;
+};
+
+#endif // IVO_UNDO_STACK_H
@@ -18,9 +18,11 @@
 #include "notification/hub.h"
 
 std::unordered_map<std::type_index, std::unordered_map<Subscriber*, std::vector<std::function<void()>>>> Hub::g_subscriptions;
+std::recursive_mutex Hub::g_mutex;
 
 void Hub::RemoveSubscriber(Subscriber* subscriber)
 {
+    std::lock_guard<std::recursive_mutex> lock(g_mutex);
     for(auto it = g_subscriptions.begin(); it != g_subscriptions.end(); it++)
         (*it).second.erase(subscriber);
 }
@@ -23,6 +23,7 @@
 #include <unordered_map>
 #include <typeindex>
 #include <vector>
+#include <mutex>
 #include "notification/notification.h"
 
 class Subscriber;
@@ -36,10 +37,18 @@ public:
     template<typename TNotification>
     static void Notify()
     {
-        TReactions& reactions = g_subscriptions[std::type_index(typeid(typename std::decay<TNotification>::type))];
-        for(auto it = reactions.begin(); it != reactions.end(); it++)
-            for(TCallback& cb : (*it).second)
-                cb();
+        //callbacks are copied so they run unlocked and may (un)subscribe; meshes notify from worker threads too
+        TCallbacks toCall;
+        {
+            std::lock_guard<std::recursive_mutex> lock(g_mutex);
+            auto found = g_subscriptions.find(std::type_index(typeid(typename std::decay<TNotification>::type)));
+            if(found == g_subscriptions.end())
+                return;
+            for(auto it = found->second.begin(); it != found->second.end(); it++)
+                toCall.insert(toCall.end(), (*it).second.begin(), (*it).second.end());
+        }
+        for(TCallback& cb : toCall)
+            cb();
     }
 
 private:
@@ -52,6 +61,7 @@ private:
     template<typename TNotification>
     static void AddSubscriber(Subscriber* subscriber, std::function<void()>&& func)
     {
+        std::lock_guard<std::recursive_mutex> lock(g_mutex);
         TReactions& reactions = g_subscriptions[std::type_index(typeid(typename std::decay<TNotification>::type))];
         TCallbacks& callbacks = reactions[subscriber];
         callbacks.emplace_back(std::move(func));
@@ -60,6 +70,7 @@ private:
     static void RemoveSubscriber(Subscriber* subscriber);
 
     static std::unordered_map<std::type_index, TReactions> g_subscriptions;
+    static std::recursive_mutex g_mutex;
 };
 
 #endif
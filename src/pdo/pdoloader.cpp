@@ -16,19 +16,101 @@
     along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <QString>
+#include <QImage>
+#include <QColor>
+#include <QRunnable>
+#include <QThreadPool>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <stdexcept>
 #include <clocale>
 #include <cstddef>
+#include <algorithm>
 #include "settings/settings.h"
 #include "mesh/mesh.h"
-#include "interface/mainwindow.h"
 #include "io/saferead.h"
+#include "io/loadprogress.h"
 #include "pdotools.h"
+#include "pdoloader.h"
 
-void CMainWindow::LoadFromPDOv2_0(const QString& filename)
+namespace
 {
+//texture pixels as stored in file, converted after all materials are read
+struct SPendingTexture
+{
+    QImage*                          image;
+    std::unique_ptr<unsigned char[]> rgb;
+};
+
+//converts rows of tightly packed RGB24 pixels into RGB32 image rows
+class CTextureBandDecoder : public QRunnable
+{
+public:
+    CTextureBandDecoder(const unsigned char* src, uchar* dst, int dstStride, int width, int rows) :
+        m_src(src),
+        m_dst(dst),
+        m_dstStride(dstStride),
+        m_width(width),
+        m_rows(rows)
+    {}
+
+    void run() override
+    {
+        const std::size_t srcStride = static_cast<std::size_t>(m_width) * 3u;
+        for(int y=0; y<m_rows; ++y)
+        {
+            const unsigned char* src = m_src + y * srcStride;
+            QRgb* dst = reinterpret_cast<QRgb*>(m_dst + y * static_cast<std::size_t>(m_dstStride));
+            for(int x=0; x<m_width; ++x, src+=3)
+                dst[x] = 0xff000000u | (static_cast<QRgb>(src[0]) << 16) | (static_cast<QRgb>(src[1]) << 8) | src[2];
+        }
+    }
+
+private:
+    const unsigned char* m_src;
+    uchar*               m_dst;
+    int                  m_dstStride;
+    int                  m_width;
+    int                  m_rows;
+};
+
+void DecodeTextures(const std::vector<SPendingTexture>& textures)
+{
+    //pixels per task, large enough to hide scheduling overhead
+    const int bandPixels = 256 * 1024;
+
+    QThreadPool pool;
+    for(const SPendingTexture& tex : textures)
+    {
+        const int width = tex.image->width();
+        const int height = tex.image->height();
+        if(width <= 0 || height <= 0)
+            continue;
+
+        uchar* bits = tex.image->bits();
+        const int stride = tex.image->bytesPerLine();
+        const int bandRows = std::max(1, bandPixels / width);
+        for(int y=0; y<height; y+=bandRows)
+        {
+            pool.start(new CTextureBandDecoder(tex.rgb.get() + static_cast<std::size_t>(y) * width * 3u,
+                                               bits + static_cast<std::size_t>(y) * stride,
+                                               stride,
+                                               width,
+                                               std::min(bandRows, height - y)));
+        }
+    }
+    pool.waitForDone();
+}
+}
+
+namespace PdoTools
+{
+
+SModelData LoadPDOv2_0(const QString& filename, CLoadProgress* progress)
+{
+    CLoadProgress noProgress;
+    CLoadProgress& prog = progress ? *progress : noProgress;
+
     std::setlocale(LC_NUMERIC, "C");
 
     CSafeFile fi(filename.toStdString());
@@ -40,27 +122,31 @@ void CMainWindow::LoadFromPDOv2_0(const QString& filename)
     std::vector<std::unique_ptr<PDO_Edge>>      edges;
     std::unordered_map<unsigned, std::string>   materialNames;
     std::unordered_map<unsigned, PDO_Part>      parts;
+    SModelData                                  data;
 
-    fi.ReadLine();//# Pepakura Designer Work Info ver 2
-    fi.ReadLine();//#
-    fi.ReadLine();//
-    fi.ReadLine();//version 2
-    fi.ReadLine();//min_version 2
-    fi.ReadLine();//
-    fi.ReadLine();//model %f %f %f %f %f %f
+    fi.SkipLine();//# Pepakura Designer Work Info ver 2
+    fi.SkipLine();//#
+    fi.SkipLine();//
+    fi.SkipLine();//version 2
+    fi.SkipLine();//min_version 2
+    fi.SkipLine();//
+    fi.SkipLine();//model %f %f %f %f %f %f
 
     int solids = 0;
     fi.LineScanf("solids %d", &solids);
+    //every solid, then materials and layout all at once
+    prog.BeginStage(CLoadProgress::S_READ, static_cast<std::size_t>(std::max(solids, 0)) + 1);
     for(int i=0; i<solids; i++)
     {
+        prog.Advance();
         std::size_t prevFacesSize = faces.size();
         std::size_t prevVerticesSize = vertices3D.size();
 
         bool skip = false;
         {
             int doNotSkip = 1;
-            fi.ReadLine();//solid
-            fi.ReadLine();//name
+            fi.SkipLine();//solid
+            fi.SkipLine();//name
             fi.LineScanf("%d", &doNotSkip);
             skip = doNotSkip == 0;
         }
@@ -135,16 +221,18 @@ void CMainWindow::LoadFromPDOv2_0(const QString& filename)
         }
     }
 
-    fi.ReadLine();//defaultmaterial
-    fi.ReadLine();//material
-    fi.ReadLine();//
-    fi.ReadLine();//default material settings, ignore
+    fi.SkipLine();//defaultmaterial
+    fi.SkipLine();//material
+    fi.SkipLine();//
+    fi.SkipLine();//default material settings, ignore
 
     int materials = 0;
     fi.LineScanf("materials %d", &materials);
+    std::vector<SPendingTexture> pendingTextures;
     for(int j=0; j<materials; j++)
     {
-        fi.ReadLine();//material
+        prog.Check();
+        fi.SkipLine();//material
         std::string matName = fi.ReadLine();
         if(matName.empty())
         {
@@ -156,37 +244,34 @@ void CMainWindow::LoadFromPDOv2_0(const QString& filename)
         float colR, colG, colB;
         fi.LineScanf("%*f %*f %*f %*f %*f %*f %*f %*f %*f %*f %*f %*f %*f %*f %*f %*f %*f %f %f %f %*d %d", &colR, &colG, &colB, &hasTexture);
 
-        m_textures[j] = std::string("<imported_") + std::to_string(j+1) + ">";
+        data.texturePaths[j] = std::string("<imported_") + std::to_string(j+1) + ">";
 
         if(hasTexture != 0)
         {
-            fi.ReadLine();//
+            fi.SkipLine();//
 
             int texWidth=0;
             int texHeight=0;
 
             fi.LineScanf("%d %d", &texWidth, &texHeight);
 
-            std::unique_ptr<unsigned char[]> imgBuffer(new unsigned char[texWidth * texHeight * 3]);
-            fi.ReadBuffer(imgBuffer.get(), sizeof(unsigned char), texWidth * texHeight * 3);
-            fi.ReadLine();
-
-            m_textureImages[j].reset(new QImage(texWidth, texHeight, QImage::Format_RGB32));
+            SPendingTexture tex;
+            tex.rgb.reset(new unsigned char[texWidth * texHeight * 3]);
+            fi.ReadBuffer(tex.rgb.get(), sizeof(unsigned char), texWidth * texHeight * 3);
+            fi.SkipLine();
 
-            for(int x=0; x<texWidth; x++)
-            for(int y=0; y<texHeight; y++)
-            {
-                unsigned char r = imgBuffer[y*texWidth*3 + x*3+0];
-                unsigned char g = imgBuffer[y*texWidth*3 + x*3+1];
-                unsigned char b = imgBuffer[y*texWidth*3 + x*3+2];
-                m_textureImages[j]->setPixel(x, y, QColor(r, g, b).rgb());
-            }
+            data.textureImages[j].reset(new QImage(texWidth, texHeight, QImage::Format_RGB32));
+            tex.image = data.textureImages[j].get();
+            pendingTextures.push_back(std::move(tex));
         } else {
-            m_textureImages[j].reset(new QImage(1, 1, QImage::Format_RGB32));
-            m_textureImages[j]->setPixel(0, 0, QColor(colR * 255, colG * 255, colB * 255).rgb());
+            data.textureImages[j].reset(new QImage(1, 1, QImage::Format_RGB32));
+            data.textureImages[j]->setPixel(0, 0, QColor(colR * 255, colG * 255, colB * 255).rgb());
         }
     }
 
+    DecodeTextures(pendingTextures);
+    pendingTextures.clear();
+
     int numParts = 0;
     fi.LineScanf("parts %d", &numParts);
     for(int j=0; j<numParts; j++)
@@ -202,10 +287,10 @@ void CMainWindow::LoadFromPDOv2_0(const QString& filename)
     fi.LineScanf("text %d", &texts);
     for(int j=0; j<texts; ++j)
     {
-        fi.ReadLine();//%d //???
-        fi.ReadLine();//font name
-        fi.ReadLine();//string
-        fi.ReadLine();//params...
+        fi.SkipLine();//%d //???
+        fi.SkipLine();//font name
+        fi.SkipLine();//string
+        fi.SkipLine();//params...
     }
 
     int pageType = 0;
@@ -213,32 +298,32 @@ void CMainWindow::LoadFromPDOv2_0(const QString& filename)
     float scale3d = 1.0f;
     glm::vec2 margins(0.0f, 0.0f);
 
-    fi.ReadLine();//info
-    fi.ReadLine();//key
-    fi.ReadLine();//iLlevel
+    fi.SkipLine();//info
+    fi.SkipLine();//key
+    fi.SkipLine();//iLlevel
     fi.LineScanf("dMag3d %f", &scale3d);
     fi.LineScanf("dMag2d %f", &scale2d);
-    fi.ReadLine();//"dTenkaizuX %f
-    fi.ReadLine();//"dTenkaizuY %f
-    fi.ReadLine();//"dTenkaizuWidth %f"  - 2D pattern width
-    fi.ReadLine();//"dTenkaizuHeight %f" - 2D pattern height
-    fi.ReadLine();//"dTenkaizuMargin %f
-    fi.ReadLine();//"bReverse %d
-    fi.ReadLine();//"bFinished %d
-    fi.ReadLine();//"iAngleEps %d
-    fi.ReadLine();//"iTaniLineType %d
-    fi.ReadLine();//"iYamaLineType %d
-    fi.ReadLine();//"iCutLineType %d
-    fi.ReadLine();//"bTextureCoodinates %d
-    fi.ReadLine();//"bDrawFlap %d"           - show flaps
-    fi.ReadLine();//"bDrawNumber %d"         - show edge ID
-    fi.ReadLine();//"bUseMaterial %d
-    fi.ReadLine();//"iEdgeNumberFontSize %d" - edge ID font size
-    fi.ReadLine();//"bNorishiroReverse %d
-    fi.ReadLine();//"bEdgeIdReverse %d"      - place edge ID outside face
-    fi.ReadLine();//"bEnableLineAlpha %d
-    fi.ReadLine();//"dTextureLineAlpha %f
-    fi.ReadLine();//"bCullEdge %d
+    fi.SkipLine();//"dTenkaizuX %f
+    fi.SkipLine();//"dTenkaizuY %f
+    fi.SkipLine();//"dTenkaizuWidth %f"  - 2D pattern width
+    fi.SkipLine();//"dTenkaizuHeight %f" - 2D pattern height
+    fi.SkipLine();//"dTenkaizuMargin %f
+    fi.SkipLine();//"bReverse %d
+    fi.SkipLine();//"bFinished %d
+    fi.SkipLine();//"iAngleEps %d
+    fi.SkipLine();//"iTaniLineType %d
+    fi.SkipLine();//"iYamaLineType %d
+    fi.SkipLine();//"iCutLineType %d
+    fi.SkipLine();//"bTextureCoodinates %d
+    fi.SkipLine();//"bDrawFlap %d"           - show flaps
+    fi.SkipLine();//"bDrawNumber %d"         - show edge ID
+    fi.SkipLine();//"bUseMaterial %d
+    fi.SkipLine();//"iEdgeNumberFontSize %d" - edge ID font size
+    fi.SkipLine();//"bNorishiroReverse %d
+    fi.SkipLine();//"bEdgeIdReverse %d"      - place edge ID outside face
+    fi.SkipLine();//"bEnableLineAlpha %d
+    fi.SkipLine();//"dTextureLineAlpha %f
+    fi.SkipLine();//"bCullEdge %d
     fi.LineScanf("iPageType %d", &pageType);//"iPageType %d
     fi.LineScanf("dPageMarginSide %f", &margins.x);
     fi.LineScanf("dPageMarginTop %f", &margins.y);
@@ -294,8 +379,7 @@ void CMainWindow::LoadFromPDOv2_0(const QString& filename)
         sheetsVertical   = 1 + (int)glm::floor(-bbox.y / borderSize.y);
     }
 
-    m_model.reset(new CMesh());
-    SetModelToWindows();
+    data.mesh.reset(new CMesh());
 
     for(int x=0; x<sheetsHorizontal; x++)
     for(int y=0; y<sheetsVertical; y++)
@@ -325,10 +409,12 @@ void CMainWindow::LoadFromPDOv2_0(const QString& filename)
         }
     }
 
-    m_model->LoadFromPDO(faces, edges, vertices3D, parts);
-    m_model->SetMaterials(materialNames);
+    prog.Advance();
+    data.mesh->LoadFromPDO(faces, edges, vertices3D, parts, &prog);
+    data.mesh->SetMaterials(materialNames);
+
 
-    for(auto it=m_textureImages.begin(); it!=m_textureImages.end(); it++)
-        if(it->second != nullptr)
-            emit UpdateTexture(it->second.get(), it->first);
+    return data;
 }
+
+}//namespace PdoTools
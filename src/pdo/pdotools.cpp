@@ -18,6 +18,10 @@
 #include <QString>
 #include <glm/common.hpp>
 #include <array>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <utility>
 #include "pdotools.h"
 #include "geometric/compgeom.h"
 #include "io/saferead.h"
@@ -45,40 +49,216 @@ void PDO_Part::ApplyOffset(const glm::vec2& off)
             v.pos += off;
 }
 
-static bool VertexIsEar(const std::vector<PDO_2DVertex>& verts, std::size_t index)
+namespace
 {
-    std::size_t sz = verts.size();
-    index += sz;
-    const glm::vec2& vA = verts[(index-1) % sz].pos;
-    const glm::vec2& vB = verts[(index+0) % sz].pos;
-    const glm::vec2& vC = verts[(index+1) % sz].pos;
-    glm::vec2 v1 = vB - vA;
-    glm::vec2 v2 = vC - vB;
-    glm::vec2 v3 = vA - vC;
-
-    if(rightTurn(v1, v2)) //path along vertices vA-vB-vC is a clockwise turn?
-        return false; //then it's not a valid triangle with counter-clockwise indexes!
-
-    for(std::size_t i=sz; i<sz*2; i++)
+typedef std::pair<std::size_t, std::size_t> TEdgeKey;
+
+struct SEdgeKeyHash
+{
+    std::size_t operator()(const TEdgeKey& key) const
     {
-        if(i == index || i == index+1 || i == index-1)
-            continue;
+        return std::hash<std::size_t>()(key.first) * 31u + std::hash<std::size_t>()(key.second);
+    }
+};
 
-        const glm::vec2& vP = verts[i%sz].pos;
+//edges of polygon being clipped, looked up by their 3D vertex indices
+class CFaceEdges
+{
+public:
+    explicit CFaceEdges(std::vector<PDO_Edge*>&& edges) :
+        m_edges(std::move(edges)),
+        m_taken(m_edges.size(), false)
+    {
+        for(std::size_t i=0; i<m_edges.size(); ++i)
+            m_lookup.emplace(TEdgeKey(m_edges[i]->vtx1ID, m_edges[i]->vtx2ID), i);
+    }
 
-        glm::vec2 vi1 = vP - vA;
-        glm::vec2 vi2 = vP - vB;
-        glm::vec2 vi3 = vP - vC;
+    void Add(PDO_Edge* edge)
+    {
+        m_lookup.emplace(TEdgeKey(edge->vtx1ID, edge->vtx2ID), m_edges.size());
+        m_edges.push_back(edge);
+        m_taken.push_back(false);
+    }
 
-        bool b1 = leftTurn(v1, vi1);
-        bool b2 = leftTurn(v2, vi2);
-        bool b3 = leftTurn(v3, vi3);
+    //nullptr if there is no edge going from vtx1 to vtx2
+    PDO_Edge* Take(std::size_t vtx1, std::size_t vtx2)
+    {
+        auto found = m_lookup.find(TEdgeKey(vtx1, vtx2));
+        if(found == m_lookup.end())
+            return nullptr;
+        const std::size_t index = found->second;
+        m_lookup.erase(found);
+        m_taken[index] = true;
+        return m_edges[index];
+    }
 
-        if(b1 && b2 && b3) //point is inside triangle we want to cut?
-            return false; //don't cut!
+    //edges that were not taken, in the order they were added
+    std::vector<PDO_Edge*> Remaining() const
+    {
+        std::vector<PDO_Edge*> remaining;
+        remaining.reserve(m_lookup.size());
+        for(std::size_t i=0; i<m_edges.size(); ++i)
+            if(!m_taken[i])
+                remaining.push_back(m_edges[i]);
+        return remaining;
     }
 
-    return true;
+private:
+    std::vector<PDO_Edge*>                                      m_edges;
+    std::vector<bool>                                           m_taken;
+    std::unordered_multimap<TEdgeKey, std::size_t, SEdgeKeyHash> m_lookup;
+};
+
+//polygon is a circular doubly linked list of vertices with cached ear status;
+//only reflex vertices can lie inside of an ear, so only they are tested
+void TriangulateFace(std::vector<PDO_Face>& faces, std::size_t faceIndex, std::vector<std::unique_ptr<PDO_Edge>>& edges)
+{
+    const std::size_t npos = std::numeric_limits<std::size_t>::max();
+    const std::vector<PDO_2DVertex> verts = faces[faceIndex].vertices;
+    const std::size_t numVerts = verts.size();
+
+    CFaceEdges primary(std::move(faces[faceIndex].edges));
+    CFaceEdges secondary(std::move(faces[faceIndex].edgesSecondary));
+
+    std::vector<std::size_t> prev(numVerts);
+    std::vector<std::size_t> next(numVerts);
+    std::vector<bool>        removed(numVerts, false);
+    std::vector<bool>        ears(numVerts, false);
+    std::vector<std::size_t> reflex;
+    std::vector<std::size_t> reflexPos(numVerts, npos);
+    for(std::size_t i=0; i<numVerts; ++i)
+    {
+        prev[i] = (i + numVerts - 1) % numVerts;
+        next[i] = (i + 1) % numVerts;
+    }
+
+    auto updateReflex = [&](std::size_t v)
+    {
+        const glm::vec2& vA = verts[prev[v]].pos;
+        const glm::vec2& vB = verts[v].pos;
+        const glm::vec2& vC = verts[next[v]].pos;
+        const bool isReflex = !removed[v] && !leftTurn(vB - vA, vC - vB);
+        if(isReflex && reflexPos[v] == npos)
+        {
+            reflexPos[v] = reflex.size();
+            reflex.push_back(v);
+        }
+        else if(!isReflex && reflexPos[v] != npos)
+        {
+            reflex[reflexPos[v]] = reflex.back();
+            reflexPos[reflex.back()] = reflexPos[v];
+            reflex.pop_back();
+            reflexPos[v] = npos;
+        }
+    };
+
+    auto isEar = [&](std::size_t v)
+    {
+        const std::size_t a = prev[v];
+        const std::size_t c = next[v];
+        const glm::vec2& vA = verts[a].pos;
+        const glm::vec2& vB = verts[v].pos;
+        const glm::vec2& vC = verts[c].pos;
+        const glm::vec2 v1 = vB - vA;
+        const glm::vec2 v2 = vC - vB;
+        const glm::vec2 v3 = vA - vC;
+
+        if(rightTurn(v1, v2)) //path along vertices vA-vB-vC is a clockwise turn?
+            return false; //then it's not a valid triangle with counter-clockwise indexes!
+
+        for(std::size_t r : reflex)
+        {
+            if(r == a || r == v || r == c)
+                continue;
+
+            const glm::vec2& vP = verts[r].pos;
+            if(leftTurn(v1, vP - vA) && leftTurn(v2, vP - vB) && leftTurn(v3, vP - vC)) //point is inside triangle we want to cut?
+                return false; //don't cut!
+        }
+        return true;
+    };
+
+    for(std::size_t i=0; i<numVerts; ++i)
+        updateReflex(i);
+    for(std::size_t i=0; i<numVerts; ++i)
+        ears[i] = isEar(i);
+
+    std::size_t remaining = numVerts;
+    std::size_t cursor = 0;
+    while(remaining > 3)
+    {
+        std::size_t v1 = cursor;
+        for(std::size_t steps=0; !ears[v1] && steps<remaining; ++steps)
+            v1 = next[v1];
+        if(!ears[v1])
+        {
+            //cached status went stale, recheck whole polygon; cut anyway if it's degenerate
+            for(std::size_t steps=0; steps<remaining; ++steps, v1=next[v1])
+                ears[v1] = isEar(v1);
+            for(std::size_t steps=0; !ears[v1] && steps<remaining; ++steps)
+                v1 = next[v1];
+        }
+
+        const std::size_t v0 = prev[v1];
+        const std::size_t v2 = next[v1];
+        const std::size_t v03D = verts[v0].index3Dvert;
+        const std::size_t v13D = verts[v1].index3Dvert;
+        const std::size_t v23D = verts[v2].index3Dvert;
+
+        faces.push_back(PDO_Face());
+        PDO_Face& newFace = faces.back();
+        newFace.id = faces.size() - 1;
+        newFace.matIndex = faces[faceIndex].matIndex;
+        newFace.partIndex = faces[faceIndex].partIndex;
+        newFace.vertices.push_back(verts[v0]);
+        newFace.vertices.push_back(verts[v1]);
+        newFace.vertices.push_back(verts[v2]);
+
+        for(PDO_Edge* edge : { primary.Take(v03D, v13D), primary.Take(v13D, v23D) })
+        {
+            if(!edge)
+                continue;
+            edge->face1ID = static_cast<int>(newFace.id);
+            newFace.edges.push_back(edge);
+        }
+        for(PDO_Edge* edge : { secondary.Take(v13D, v03D), secondary.Take(v23D, v13D) })
+        {
+            if(!edge)
+                continue;
+            edge->face2ID = static_cast<int>(newFace.id);
+            newFace.edgesSecondary.push_back(edge);
+        }
+
+        PDO_Edge newEdge;
+        newEdge.face1ID = static_cast<int>(faceIndex);
+        newEdge.face2ID = static_cast<int>(newFace.id);
+        newEdge.snapped = true;
+        newEdge.vtx1ID = v03D;
+        newEdge.vtx2ID = v23D;
+        edges.push_back(std::unique_ptr<PDO_Edge>(new PDO_Edge(newEdge)));
+        primary.Add(edges.back().get());
+        newFace.edgesSecondary.push_back(edges.back().get());
+
+        removed[v1] = true;
+        next[v0] = v2;
+        prev[v2] = v0;
+        --remaining;
+        updateReflex(v1);
+        updateReflex(v0);
+        updateReflex(v2);
+        ears[v0] = isEar(v0);
+        ears[v2] = isEar(v2);
+        cursor = v2;
+    }
+
+    PDO_Face& face = faces[faceIndex];
+    face.vertices.clear();
+    for(std::size_t i=0; i<numVerts; ++i)
+        if(!removed[i])
+            face.vertices.push_back(verts[i]);
+    face.edges = primary.Remaining();
+    face.edgesSecondary = secondary.Remaining();
+}
 }
 
 namespace PdoTools
@@ -128,76 +308,15 @@ glm::vec2 GetPDOPaperSize(int paperType)
 void TriangulateFaces(std::vector<PDO_Face>& faces, std::vector<std::unique_ptr<PDO_Edge>>& edges)
 {
     const std::size_t sz = faces.size(); //only old faces can be not-triangles
+    std::size_t newFaces = 0;
     for(std::size_t i=0; i<sz; i++)
-    {
-        std::size_t vertSz = faces[i].vertices.size();
-        while(vertSz > 3)
-        {
-            for(std::size_t j=0; j<vertSz; j++)
-            {
-                if(VertexIsEar(faces[i].vertices, j))
-                {
-                    const std::size_t v0 = (j+vertSz-1)%vertSz;
-                    const std::size_t v1 = j;
-                    const std::size_t v2 = (j+vertSz+1)%vertSz;
-                    const std::size_t v03D = faces[i].vertices[v0].index3Dvert;
-                    const std::size_t v13D = faces[i].vertices[v1].index3Dvert;
-                    const std::size_t v23D = faces[i].vertices[v2].index3Dvert;
-
-                    faces.push_back(PDO_Face());
-                    PDO_Face& newFace = faces.back();
-                    newFace.id = faces.size() - 1;
-                    newFace.matIndex = faces[i].matIndex;
-                    newFace.partIndex = faces[i].partIndex;
-                    newFace.vertices.push_back(faces[i].vertices[v0]);
-                    newFace.vertices.push_back(faces[i].vertices[v1]);
-                    newFace.vertices.push_back(faces[i].vertices[v2]);
-
-                    for(int k=0; k<2; k++)
-                    {
-                        for(unsigned edg=0; edg<faces[i].edges.size(); edg++)
-                        {
-                            PDO_Edge* edge = faces[i].edges[edg];
-                            if((edge->vtx1ID == v03D && edge->vtx2ID == v13D) ||
-                               (edge->vtx1ID == v13D && edge->vtx2ID == v23D))
-                            {
-                                edge->face1ID = static_cast<int>(faces.size() - 1);//index of pushed face
-                                newFace.edges.push_back(edge);
-                                faces[i].edges.erase(faces[i].edges.begin() + edg);
-                                break;
-                            }
-                        }
-                        for(unsigned edg=0; edg<faces[i].edgesSecondary.size(); edg++)
-                        {
-                            PDO_Edge* edge = faces[i].edgesSecondary[edg];
-                            if((edge->vtx1ID == v13D && edge->vtx2ID == v03D) ||
-                               (edge->vtx1ID == v23D && edge->vtx2ID == v13D))
-                            {
-                                edge->face2ID = static_cast<int>(faces.size() - 1);
-                                newFace.edgesSecondary.push_back(edge);
-                                faces[i].edgesSecondary.erase(faces[i].edgesSecondary.begin() + edg);
-                                break;
-                            }
-                        }
-                    }
-
-                    PDO_Edge newEdge;
-                    newEdge.face1ID = static_cast<int>(i);
-                    newEdge.face2ID = static_cast<int>(faces.size() - 1);
-                    newEdge.snapped = true;
-                    newEdge.vtx1ID = faces[i].vertices[v0].index3Dvert;
-                    newEdge.vtx2ID = faces[i].vertices[v2].index3Dvert;
-                    edges.push_back(std::unique_ptr<PDO_Edge>(new PDO_Edge(newEdge)));
-                    faces[i].edges.push_back(edges.back().get());
-                    newFace.edgesSecondary.push_back(edges.back().get());
-
-                    faces[i].vertices.erase(faces[i].vertices.begin() + j);
-                    vertSz--;
-                    break;
-                }
-            }
-        }
-    }
+        if(faces[i].vertices.size() > 3)
+            newFaces += faces[i].vertices.size() - 3;
+    faces.reserve(sz + newFaces);
+
+    for(std::size_t i=0; i<sz; i++)
+        if(faces[i].vertices.size() > 3)
+            TriangulateFace(faces, i, edges);
 }
 
 }//namespace PdoTools
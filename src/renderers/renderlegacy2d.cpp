@@ -337,7 +337,7 @@ void CRenderer2DLegacy::DrawFlaps() const
     if(m_texFolds)
         m_texFolds->bind();
 
-    const std::list<CMesh::SEdge>& edges = m_model->GetEdges();
+    const std::vector<CMesh::SEdge>& edges = m_model->GetEdges();
 
     m_gl.glBegin(GL_QUADS);
     for(const CMesh::SEdge &e : edges)
@@ -347,14 +347,14 @@ void CRenderer2DLegacy::DrawFlaps() const
             switch(e.GetFlapPosition())
             {
             case CMesh::SEdge::FP_LEFT:
-                RenderFlap(e.GetTriangle(0), e.GetTriIndex(0));
+                RenderFlap(m_model->GetEdgeTriangle(e, 0), e.GetTriIndex(0));
                 break;
             case CMesh::SEdge::FP_RIGHT:
-                RenderFlap(e.GetTriangle(1), e.GetTriIndex(1));
+                RenderFlap(m_model->GetEdgeTriangle(e, 1), e.GetTriIndex(1));
                 break;
             case CMesh::SEdge::FP_BOTH:
-                RenderFlap(e.GetTriangle(0), e.GetTriIndex(0));
-                RenderFlap(e.GetTriangle(1), e.GetTriIndex(1));
+                RenderFlap(m_model->GetEdgeTriangle(e, 0), e.GetTriIndex(0));
+                RenderFlap(m_model->GetEdgeTriangle(e, 1), e.GetTriIndex(1));
                 break;
             case CMesh::SEdge::FP_NONE:
             default:
@@ -377,7 +377,8 @@ void CRenderer2DLegacy::DrawGroups() const
     for(auto it=groups.begin(); it!=groups.end(); ++it)
     {
         const CMesh::STriGroup &grp = *it;
-        const std::list<CMesh::STriangle2D*>& grpTris = grp.GetTriangles();
+        const CMesh::CTriangleRange grpTris = grp.GetTriangles();
+        grp.UpdateWorldData();
 
         for(auto it2=grpTris.begin(), itEnd = grpTris.end(); it2!=itEnd; ++it2)
         {
@@ -421,7 +422,7 @@ void CRenderer2DLegacy::DrawEdges() const
     if(m_texFolds)
         m_texFolds->bind();
 
-    const std::list<CMesh::SEdge>& edges = m_model->GetEdges();
+    const std::vector<CMesh::SEdge>& edges = m_model->GetEdges();
 
     m_gl.glBegin(GL_QUADS);
     for(const CMesh::SEdge &e : edges)
@@ -436,14 +437,14 @@ void CRenderer2DLegacy::DrawEdges() const
          {
              if(e.GetAngle() > maxFlatAngle)
              {
-                RenderEdge(e.GetTriangle(0), e.GetTriIndex(0), foldType);
+                RenderEdge(m_model->GetEdgeTriangle(e, 0), e.GetTriIndex(0), foldType);
              }
          } else if(!e.IsSnapped() && (renFlags & CSettings::R_EDGES)) {
-             RenderEdge(e.GetTriangle(0), e.GetTriIndex(0), CMesh::SEdge::FT_FLAT);
-             RenderEdge(e.GetTriangle(1), e.GetTriIndex(1), CMesh::SEdge::FT_FLAT);
+             RenderEdge(m_model->GetEdgeTriangle(e, 0), e.GetTriIndex(0), CMesh::SEdge::FT_FLAT);
+             RenderEdge(m_model->GetEdgeTriangle(e, 1), e.GetTriIndex(1), CMesh::SEdge::FT_FLAT);
          }
      } else if(renFlags & CSettings::R_EDGES) {
-         void *t = static_cast<void*>(e.GetAnyTriangle());
+         const void *t = m_model->GetAnyEdgeTriangle(e);
          int edge = e.GetAnyTriIndex();
          RenderEdge(t, edge, CMesh::SEdge::FT_FLAT);
      }
@@ -455,12 +456,12 @@ void CRenderer2DLegacy::DrawEdges() const
         m_texFolds->release();
 }
 
-void CRenderer2DLegacy::RenderFlap(void *tr, int edge) const
+void CRenderer2DLegacy::RenderFlap(const void *tr, int edge) const
 {
-    const CMesh::STriangle2D& t = *static_cast<CMesh::STriangle2D*>(tr);
+    const CMesh::STriangle2D& t = *static_cast<const CMesh::STriangle2D*>(tr);
     const CMesh::STriGroup *g = t.GetGroup();
-    const float dep = g->GetDepth() + CMesh::STriGroup::GetDepthStep()*0.3f;
-    const float dep2 = dep + CMesh::STriGroup::GetDepthStep()*0.15f;
+    const float dep = g->GetDepth() + g->GetDepthStep()*0.3f;
+    const float dep2 = dep + g->GetDepthStep()*0.15f;
     const glm::vec2 &v1 = t[edge];
     const glm::vec2 &v2 = t[(edge+1)%3];
     const glm::vec2 vN = t.GetNormal(edge) * 0.5f;
@@ -517,15 +518,15 @@ void CRenderer2DLegacy::RenderFlap(void *tr, int edge) const
     }
 }
 
-void CRenderer2DLegacy::RenderEdge(void *tr, int edge, int foldType) const
+void CRenderer2DLegacy::RenderEdge(const void *tr, int edge, int foldType) const
 {
-    const CMesh::STriangle2D& t = *static_cast<CMesh::STriangle2D*>(tr);
+    const CMesh::STriangle2D& t = *static_cast<const CMesh::STriangle2D*>(tr);
     const CMesh::STriGroup *g = t.GetGroup();
     const glm::vec2 &v1 = t[edge];
     const glm::vec2 &v2 = t[(edge+1)%3];
     const glm::vec2 vN = t.GetNormal(edge) * 0.015f * CSettings::GetInstance().GetLineWidth();
     const float len = t.GetEdgeLen(edge) * (float)CSettings::GetInstance().GetStippleLoop();
-    const float dep = g->GetDepth() - CMesh::STriGroup::GetDepthStep()*0.3f;
+    const float dep = g->GetDepth() - g->GetDepthStep()*0.3f;
 
     float foldSelector = 1.0f;
 
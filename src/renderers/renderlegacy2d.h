@@ -40,19 +40,22 @@ public:
 
     void    ClearTextures() override;
 
+protected:
+    virtual void DrawParts() const;
+    virtual void DrawFlaps() const;
+    virtual void DrawGroups() const;
+    virtual void DrawEdges() const;
+
+    QOpenGLFunctions_2_0&   m_gl;
+
 private:
-    void    DrawParts() const;
-    void    DrawFlaps() const;
-    void    DrawGroups() const;
-    void    DrawEdges() const;
-    void    RenderFlap(void *tr, int edge) const;
-    void    RenderEdge(void *tr, int edge, int foldType) const;
+    void    RenderFlap(const void *tr, int edge) const;
+    void    RenderEdge(const void *tr, int edge, int foldType) const;
 
     void    BindTexture(unsigned id) const;
     void    UnbindTexture() const;
 
     mutable int             m_boundTextureID = -1;
-    QOpenGLFunctions_2_0&   m_gl;
 };
 
 #endif // RENDERLEGACY2D_H
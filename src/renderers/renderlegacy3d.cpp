@@ -89,13 +89,7 @@ void CRenderer3DLegacy::DrawModel() const
     if(!m_model)
         return;
 
-    m_gl.glClear(GL_DEPTH_BUFFER_BIT);
-    m_gl.glMatrixMode(GL_MODELVIEW);
-    m_gl.glLoadIdentity();
-    m_gl.glMultMatrixf(&m_viewMatrix[0][0]);
-
-    const glm::vec4 lightPosition = {m_cameraPosition.x, m_cameraPosition.y, m_cameraPosition.z, 1.0f};
-    m_gl.glLightfv(GL_LIGHT1, GL_POSITION, &lightPosition[0]);
+    SetupModelView();
 
     const std::vector<glm::vec3> &vert = m_model->GetVertices();
     const std::vector<glm::vec2> &uvs = m_model->GetUVCoords();
@@ -142,6 +136,17 @@ void CRenderer3DLegacy::DrawModel() const
     UnbindTexture();
 }
 
+void CRenderer3DLegacy::SetupModelView() const
+{
+    m_gl.glClear(GL_DEPTH_BUFFER_BIT);
+    m_gl.glMatrixMode(GL_MODELVIEW);
+    m_gl.glLoadIdentity();
+    m_gl.glMultMatrixf(&m_viewMatrix[0][0]);
+
+    const glm::vec4 lightPosition = {m_cameraPosition.x, m_cameraPosition.y, m_cameraPosition.z, 1.0f};
+    m_gl.glLightfv(GL_LIGHT1, GL_POSITION, &lightPosition[0]);
+}
+
 void CRenderer3DLegacy::DrawBackground() const
 {
     m_gl.glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -41,8 +41,13 @@ public:
 
     void    ClearTextures() override;
 
+protected:
+    virtual void DrawModel() const;
+    void    SetupModelView() const;
+
+    QOpenGLFunctions_2_0&   m_gl;
+
 private:
-    void    DrawModel() const;
     void    DrawBackground() const;
     void    DrawGrid() const;
     void    DrawAxis() const;
@@ -51,7 +56,6 @@ private:
     void    UnbindTexture() const;
 
     mutable int             m_boundTextureID = -1;
-    QOpenGLFunctions_2_0&   m_gl;
 };
 
 #endif // RENDERLEGACY3D_H
@@ -0,0 +1,389 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <map>
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <glm/matrix.hpp>
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include "rendervbo2d.h"
+#include "settings/settings.h"
+
+namespace
+{
+struct SVertex
+{
+    GLfloat x, y, z;
+    GLfloat u, v;
+};
+
+//maps points from paper space to group's local space
+class CLocalSpace
+{
+public:
+    explicit CLocalSpace(const CMesh::STriGroup& grp) :
+        m_origin(grp.GetPosition())
+    {
+        const float rotRAD = glm::radians(grp.GetRotation());
+        const float c = glm::cos(rotRAD);
+        const float s = glm::sin(rotRAD);
+        m_invRotation = glm::mat2(glm::vec2(c, -s), glm::vec2(s, c));
+    }
+
+    //z is measured in depth steps
+    SVertex operator()(const glm::vec2& p, float z, float u, float v) const
+    {
+        const glm::vec2 loc = m_invRotation * (p - m_origin);
+        return SVertex{loc.x, loc.y, z, u, v};
+    }
+
+private:
+    glm::vec2 m_origin;
+    glm::mat2 m_invRotation;
+};
+
+//same geometry as CRenderer2DLegacy::RenderFlap
+void AppendFlap(const CLocalSpace& toLocal, const CMesh::STriangle2D& t, int edge, float lineWidth, std::vector<SVertex>& out)
+{
+    const float dep = -0.3f;
+    const float dep2 = -0.45f;
+    const glm::vec2 &v1 = t[edge];
+    const glm::vec2 &v2 = t[(edge+1)%3];
+    const glm::vec2 vN = t.GetNormal(edge) * 0.5f;
+
+    glm::vec2 p[4];
+    if(t.IsFlapSharp(edge))
+    {
+        p[0] = v1;
+        p[1] = 0.5f*v1 + 0.5f*v2 + vN;
+        p[2] = v2;
+        p[3] = 0.5f*v1 + 0.5f*v2;
+    } else {
+        p[0] = v1;
+        p[1] = 0.9f*v1 + 0.1f*v2 + vN;
+        p[2] = 0.1f*v1 + 0.9f*v2 + vN;
+        p[3] = v2;
+    }
+
+    static const glm::mat2 rotMx90deg = glm::mat2(glm::vec2(0.0f, 1.0f),
+                                                  glm::vec2(-1.0f, 0.0f));
+    const float normalScaler = 0.015f * lineWidth;
+
+    //inner part of flap
+    for(int i=0; i<4; i++)
+        out.push_back(toLocal(p[i], dep2, 0.0f, 0.8f)); //white
+
+    //edges of flap
+    for(int i=0; i<4; i++)
+    {
+        const glm::vec2& p1 = p[i];
+        const glm::vec2& p2 = p[(i+1)%4];
+        const glm::vec2 eN = glm::normalize(rotMx90deg * (p2 - p1)) * normalScaler;
+
+        out.push_back(toLocal(p1 - eN, dep, 0.0f, 0.1f)); //black
+        out.push_back(toLocal(p1 + eN, dep, 0.0f, 0.1f));
+        out.push_back(toLocal(p2 + eN, dep, 0.0f, 0.1f));
+        out.push_back(toLocal(p2 - eN, dep, 0.0f, 0.1f));
+    }
+}
+
+//same geometry as CRenderer2DLegacy::RenderEdge
+void AppendEdge(const CLocalSpace& toLocal, const CMesh::STriangle2D& t, int edge, int foldType,
+                float lineWidth, unsigned stippleLoop, std::vector<SVertex>& out)
+{
+    const glm::vec2 &v1 = t[edge];
+    const glm::vec2 &v2 = t[(edge+1)%3];
+    const glm::vec2 vN = t.GetNormal(edge) * 0.015f * lineWidth;
+    const float len = t.GetEdgeLen(edge) * (float)stippleLoop;
+    const float dep = 0.3f;
+
+    float foldSelector = 1.0f;
+    switch(foldType)
+    {
+    case CMesh::SEdge::FT_FLAT:
+        foldSelector = 1.0f;
+        break;
+    case CMesh::SEdge::FT_VALLEY:
+        foldSelector = 2.0f;
+        break;
+    case CMesh::SEdge::FT_MOUNTAIN:
+        foldSelector = 3.0f;
+        break;
+    default: assert(false);
+    }
+
+    static const float oneForth = 1.0f/4.0f;
+    const float vLow = oneForth * (foldSelector - 1.0f) + 0.1f;
+    const float vHigh = oneForth * foldSelector - 0.1f;
+
+    out.push_back(toLocal(v1 - vN, dep, 0.0f, vLow));
+    out.push_back(toLocal(v1 + vN, dep, 0.0f, vHigh));
+    out.push_back(toLocal(v2 + vN, dep, len, vHigh));
+    out.push_back(toLocal(v2 - vN, dep, len, vLow));
+}
+
+void SetVertexPointers(QOpenGLFunctions_2_0& gl)
+{
+    gl.glVertexPointer(3, GL_FLOAT, sizeof(SVertex), reinterpret_cast<const void*>(offsetof(SVertex, x)));
+    gl.glTexCoordPointer(2, GL_FLOAT, sizeof(SVertex), reinterpret_cast<const void*>(offsetof(SVertex, u)));
+}
+}
+
+bool CRenderer2DVBO::SGeometryParams::operator==(const SGeometryParams& o) const
+{
+    return renFlags == o.renFlags &&
+           lineWidth == o.lineWidth &&
+           stippleLoop == o.stippleLoop &&
+           maxFlatAngle == o.maxFlatAngle;
+}
+
+CRenderer2DVBO::CRenderer2DVBO(QOpenGLFunctions_2_0& gl) :
+    CRenderer2DLegacy(gl)
+{
+}
+
+CRenderer2DVBO::~CRenderer2DVBO()
+{
+}
+
+void CRenderer2DVBO::SetModel(const CMesh *mdl)
+{
+    m_buffers.clear();
+    CRenderer2DLegacy::SetModel(mdl);
+}
+
+void CRenderer2DVBO::DrawParts() const
+{
+    UpdateBuffers();
+
+    m_gl.glEnableClientState(GL_VERTEX_ARRAY);
+    m_gl.glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    CRenderer2DLegacy::DrawParts();
+
+    m_gl.glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    m_gl.glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void CRenderer2DVBO::UpdateBuffers() const
+{
+    const CSettings& sett = CSettings::GetInstance();
+    SGeometryParams params;
+    params.renFlags = sett.GetRenderFlags() & (CSettings::R_EDGES | CSettings::R_FOLDS);
+    params.lineWidth = sett.GetLineWidth();
+    params.stippleLoop = sett.GetStippleLoop();
+    params.maxFlatAngle = sett.GetFoldMaxFlatAngle();
+
+    const bool rebuildAll = !(params == m_params);
+    m_params = params;
+
+    for(auto& buf : m_buffers)
+        buf.second.used = false;
+
+    for(const CMesh::STriGroup& grp : m_model->GetGroups())
+    {
+        SGroupBuffer& buf = m_buffers[&grp];
+        buf.used = true;
+        if(rebuildAll || buf.revision != grp.GetRevision())
+        {
+            BuildGroupBuffer(grp, buf);
+            buf.revision = grp.GetRevision();
+        }
+    }
+
+    //forget groups that no longer exist
+    for(auto it = m_buffers.begin(); it != m_buffers.end();)
+    {
+        if(it->second.used)
+            ++it;
+        else
+            it = m_buffers.erase(it);
+    }
+}
+
+void CRenderer2DVBO::BuildGroupBuffer(const CMesh::STriGroup& grp, SGroupBuffer& buf) const
+{
+    const CLocalSpace toLocal(grp);
+    const std::vector<glm::vec2> &uvs = m_model->GetUVCoords();
+    const std::vector<glm::uvec4> &tris = m_model->GetTriangles();
+    const float maxFlatAngle = (float)m_params.maxFlatAngle;
+
+    std::map<unsigned, std::vector<SVertex>> trisByMaterial;
+    std::vector<SVertex> flaps;
+    std::vector<SVertex> edges;
+
+    grp.UpdateWorldData();
+    for(const CMesh::STriangle2D* tri : grp.GetTriangles())
+    {
+        const CMesh::STriangle2D& tr2D = *tri;
+        const glm::uvec4 &t = tris[tr2D.ID()];
+
+        std::vector<SVertex>& mtlTris = trisByMaterial[t[3]];
+        for(int v=0; v<3; ++v)
+            mtlTris.push_back(toLocal(tr2D[v], 0.0f, uvs[t[v]].x, uvs[t[v]].y));
+
+        for(int e=0; e<3; ++e)
+        {
+            const CMesh::SEdge& edg = *tr2D.GetEdge(e);
+
+            //every flap and edge is owned by the triangle it is drawn from
+            if(!edg.IsSnapped())
+            {
+                const int flapPos = (int)edg.GetFlapPosition();
+                for(int side=0; side<2; ++side)
+                {
+                    if((flapPos & (1 << side)) && m_model->GetEdgeTriangle(edg, side) == tri)
+                        AppendFlap(toLocal, tr2D, e, m_params.lineWidth, flaps);
+                }
+            }
+
+            const int foldType = (int)edg.GetFoldType();
+            if(foldType == CMesh::SEdge::FT_FLAT && edg.IsSnapped())
+                continue;
+
+            if(edg.HasTwoTriangles())
+            {
+                if(edg.IsSnapped() && (m_params.renFlags & CSettings::R_FOLDS))
+                {
+                    if(edg.GetAngle() > maxFlatAngle && m_model->GetEdgeTriangle(edg, 0) == tri)
+                        AppendEdge(toLocal, tr2D, e, foldType, m_params.lineWidth, m_params.stippleLoop, edges);
+                } else if(!edg.IsSnapped() && (m_params.renFlags & CSettings::R_EDGES)) {
+                    AppendEdge(toLocal, tr2D, e, CMesh::SEdge::FT_FLAT, m_params.lineWidth, m_params.stippleLoop, edges);
+                }
+            } else if(m_params.renFlags & CSettings::R_EDGES) {
+                AppendEdge(toLocal, tr2D, e, CMesh::SEdge::FT_FLAT, m_params.lineWidth, m_params.stippleLoop, edges);
+            }
+        }
+    }
+
+    std::vector<SVertex> vertices;
+    vertices.reserve(3 * grp.GetTriangles().size() + flaps.size() + edges.size());
+
+    buf.triBatches.clear();
+    for(const auto& mtl : trisByMaterial)
+    {
+        buf.triBatches.push_back({mtl.first, (GLint)vertices.size(), (GLsizei)mtl.second.size()});
+        vertices.insert(vertices.end(), mtl.second.begin(), mtl.second.end());
+    }
+    buf.flaps = {0u, (GLint)vertices.size(), (GLsizei)flaps.size()};
+    vertices.insert(vertices.end(), flaps.begin(), flaps.end());
+    buf.edges = {0u, (GLint)vertices.size(), (GLsizei)edges.size()};
+    vertices.insert(vertices.end(), edges.begin(), edges.end());
+
+    if(!buf.vbo.isCreated())
+    {
+        buf.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        if(!buf.vbo.create())
+            throw std::logic_error("Failed to create vertex buffer object");
+    }
+    buf.vbo.bind();
+    buf.vbo.allocate(vertices.data(), (int)(vertices.size() * sizeof(SVertex)));
+    buf.vbo.release();
+}
+
+bool CRenderer2DVBO::BindGroup(const CMesh::STriGroup& grp, SGroupBuffer& buf) const
+{
+    if(!buf.vbo.isCreated())
+        return false;
+
+    const glm::vec2 pos = grp.GetPosition();
+    m_gl.glPushMatrix();
+    m_gl.glTranslatef(pos.x, pos.y, -grp.GetDepth());
+    m_gl.glRotatef(grp.GetRotation(), 0.0f, 0.0f, 1.0f);
+    m_gl.glScalef(1.0f, 1.0f, grp.GetDepthStep());
+
+    buf.vbo.bind();
+    SetVertexPointers(m_gl);
+    return true;
+}
+
+void CRenderer2DVBO::ReleaseGroup(SGroupBuffer& buf) const
+{
+    buf.vbo.release();
+    m_gl.glPopMatrix();
+}
+
+void CRenderer2DVBO::DrawFlaps() const
+{
+    if(m_texFolds)
+        m_texFolds->bind();
+
+    for(const CMesh::STriGroup& grp : m_model->GetGroups())
+    {
+        SGroupBuffer& buf = m_buffers[&grp];
+        if(buf.flaps.count == 0 || !BindGroup(grp, buf))
+            continue;
+        m_gl.glDrawArrays(GL_QUADS, buf.flaps.first, buf.flaps.count);
+        ReleaseGroup(buf);
+    }
+
+    if(m_texFolds && m_texFolds->isBound())
+        m_texFolds->release();
+}
+
+void CRenderer2DVBO::DrawGroups() const
+{
+    const bool renTexture = CSettings::GetInstance().GetRenderFlags() & CSettings::R_TEXTR;
+
+    for(const CMesh::STriGroup& grp : m_model->GetGroups())
+    {
+        SGroupBuffer& buf = m_buffers[&grp];
+        if(buf.triBatches.empty() || !BindGroup(grp, buf))
+            continue;
+
+        for(const SBatch& batch : buf.triBatches)
+        {
+            QOpenGLTexture* tex = nullptr;
+            if(renTexture)
+            {
+                auto it = m_textures.find(batch.material);
+                if(it != m_textures.end())
+                    tex = it->second.get();
+            }
+            if(tex)
+                tex->bind();
+            m_gl.glDrawArrays(GL_TRIANGLES, batch.first, batch.count);
+            if(tex)
+                tex->release();
+        }
+        ReleaseGroup(buf);
+    }
+}
+
+void CRenderer2DVBO::DrawEdges() const
+{
+    m_gl.glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    m_gl.glEnable(GL_BLEND);
+
+    if(m_texFolds)
+        m_texFolds->bind();
+
+    for(const CMesh::STriGroup& grp : m_model->GetGroups())
+    {
+        SGroupBuffer& buf = m_buffers[&grp];
+        if(buf.edges.count == 0 || !BindGroup(grp, buf))
+            continue;
+        m_gl.glDrawArrays(GL_QUADS, buf.edges.first, buf.edges.count);
+        ReleaseGroup(buf);
+    }
+    m_gl.glDisable(GL_BLEND);
+
+    if(m_texFolds && m_texFolds->isBound())
+        m_texFolds->release();
+}
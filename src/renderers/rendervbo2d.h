@@ -0,0 +1,82 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef RENDERVBO2D_H
+#define RENDERVBO2D_H
+#include <QOpenGLBuffer>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include "renderlegacy2d.h"
+#include "mesh/mesh.h"
+
+//Keeps every group in its own vertex buffer (in group's local space),
+//so moving or rotating a group only changes the transform it is drawn with
+class CRenderer2DVBO : public CRenderer2DLegacy
+{
+public:
+    CRenderer2DVBO(QOpenGLFunctions_2_0& gl);
+    virtual ~CRenderer2DVBO();
+
+    void    SetModel(const CMesh* mdl) override;
+
+protected:
+    void    DrawParts() const override;
+    void    DrawFlaps() const override;
+    void    DrawGroups() const override;
+    void    DrawEdges() const override;
+
+private:
+    struct SBatch
+    {
+        unsigned    material;
+        GLint       first;
+        GLsizei     count;
+    };
+
+    struct SGroupBuffer
+    {
+        std::uint64_t       revision = 0;
+        QOpenGLBuffer       vbo;
+        std::vector<SBatch> triBatches;
+        SBatch              flaps = {0u, 0, 0};
+        SBatch              edges = {0u, 0, 0};
+        bool                used = false;
+    };
+
+    //settings that geometry of flaps and edges depends on
+    struct SGeometryParams
+    {
+        unsigned char   renFlags = 0;
+        float           lineWidth = 0.0f;
+        unsigned        stippleLoop = 0u;
+        unsigned char   maxFlatAngle = 0;
+
+        bool operator==(const SGeometryParams& o) const;
+    };
+
+    void    UpdateBuffers() const;
+    void    BuildGroupBuffer(const CMesh::STriGroup& grp, SGroupBuffer& buf) const;
+    bool    BindGroup(const CMesh::STriGroup& grp, SGroupBuffer& buf) const;
+    void    ReleaseGroup(SGroupBuffer& buf) const;
+
+    mutable std::unordered_map
+        <const CMesh::STriGroup*, SGroupBuffer> m_buffers;
+    mutable SGeometryParams                     m_params;
+};
+
+#endif // RENDERVBO2D_H
@@ -0,0 +1,221 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <numeric>
+#include <cstddef>
+#include <stdexcept>
+#include "rendervbo3d.h"
+#include "settings/settings.h"
+#include "mesh/mesh.h"
+
+namespace
+{
+struct SVertex
+{
+    GLfloat x, y, z;
+    GLfloat nx, ny, nz;
+    GLfloat u, v;
+};
+
+//RGBA for each of 3 vertices of a triangle
+const std::size_t g_ColorBytesPerTri = 12;
+}
+
+CRenderer3DVBO::CRenderer3DVBO(QOpenGLFunctions_2_0& gl) :
+    CRenderer3DLegacy(gl),
+    m_vertexBuffer(QOpenGLBuffer::VertexBuffer),
+    m_colorBuffer(QOpenGLBuffer::VertexBuffer)
+{
+}
+
+CRenderer3DVBO::~CRenderer3DVBO()
+{
+}
+
+void CRenderer3DVBO::SetModel(const CMesh *mdl)
+{
+    m_geometryRevision = 0;
+    m_pickRevision = 0;
+    CRenderer3DLegacy::SetModel(mdl);
+}
+
+void CRenderer3DVBO::UpdateGeometry() const
+{
+    const std::vector<glm::vec3> &vert = m_model->GetVertices();
+    const std::vector<glm::vec2> &uvs = m_model->GetUVCoords();
+    const std::vector<glm::vec3> &norms = m_model->GetNormals();
+    const std::vector<glm::uvec4> &tris = m_model->GetTriangles();
+
+    //order triangles by material, keeping original order inside material
+    std::vector<std::size_t> order(tris.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&tris](std::size_t a, std::size_t b)
+    {
+        return tris[a][3] < tris[b][3];
+    });
+
+    std::vector<SVertex> vertices;
+    vertices.reserve(3 * tris.size());
+    m_triSlots.assign(tris.size(), 0u);
+    m_batches.clear();
+
+    for(std::size_t slot = 0; slot < order.size(); ++slot)
+    {
+        const std::size_t i = order[slot];
+        const glm::uvec4 &t = tris[i];
+        const glm::vec3 &n = norms[i];
+
+        if(m_batches.empty() || m_batches.back().material != t[3])
+            m_batches.push_back({t[3], (GLint)vertices.size(), 0});
+        m_batches.back().count += 3;
+        m_triSlots[i] = static_cast<GLuint>(slot);
+
+        for(int v=0; v<3; ++v)
+        {
+            const glm::vec3 &p = vert[t[v]];
+            const glm::vec2 &uv = uvs[t[v]];
+            vertices.push_back(SVertex{p.x, p.y, p.z, n.x, n.y, n.z, uv.x, uv.y});
+        }
+    }
+
+    m_colors.assign(g_ColorBytesPerTri * tris.size(), 255u);
+    m_uploadedPicks.clear();
+
+    if(!m_vertexBuffer.isCreated())
+    {
+        m_vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+        m_colorBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+        if(!m_vertexBuffer.create() || !m_colorBuffer.create())
+            throw std::logic_error("Failed to create vertex buffer object");
+    }
+    m_vertexBuffer.bind();
+    m_vertexBuffer.allocate(vertices.data(), (int)(vertices.size() * sizeof(SVertex)));
+    m_vertexBuffer.release();
+
+    m_colorBuffer.bind();
+    m_colorBuffer.allocate(m_colors.data(), (int)m_colors.size());
+    m_colorBuffer.release();
+
+    //force colors of picked triangles to be uploaded
+    m_pickRevision = 0;
+}
+
+void CRenderer3DVBO::SetTriangleColor(std::size_t tri, bool picked, std::size_t& dirtyFirst, std::size_t& dirtyLast) const
+{
+    if(tri >= m_triSlots.size())
+        return;
+    const std::size_t slot = m_triSlots[tri];
+    GLubyte* color = &m_colors[slot * g_ColorBytesPerTri];
+    for(int v=0; v<3; ++v)
+    {
+        color[4*v + 0] = 255u;
+        color[4*v + 1] = picked ? 0u : 255u;
+        color[4*v + 2] = picked ? 0u : 255u;
+        color[4*v + 3] = 255u;
+    }
+    dirtyFirst = std::min(dirtyFirst, slot);
+    dirtyLast = std::max(dirtyLast, slot);
+}
+
+void CRenderer3DVBO::UpdatePickColors() const
+{
+    const std::unordered_set<std::size_t>& picked = m_model->GetPickedTris();
+
+    std::size_t dirtyFirst = m_triSlots.size();
+    std::size_t dirtyLast = 0;
+
+    for(std::size_t tri : m_uploadedPicks)
+    {
+        if(picked.find(tri) == picked.end())
+            SetTriangleColor(tri, false, dirtyFirst, dirtyLast);
+    }
+    for(std::size_t tri : picked)
+    {
+        if(m_uploadedPicks.find(tri) == m_uploadedPicks.end())
+            SetTriangleColor(tri, true, dirtyFirst, dirtyLast);
+    }
+    m_uploadedPicks = picked;
+
+    if(dirtyFirst > dirtyLast)
+        return;
+
+    const std::size_t offset = dirtyFirst * g_ColorBytesPerTri;
+    const std::size_t size = (dirtyLast - dirtyFirst + 1) * g_ColorBytesPerTri;
+    m_colorBuffer.bind();
+    m_colorBuffer.write((int)offset, &m_colors[offset], (int)size);
+    m_colorBuffer.release();
+}
+
+void CRenderer3DVBO::DrawModel() const
+{
+    if(!m_model)
+        return;
+
+    if(m_geometryRevision != m_model->GetGeometryRevision())
+    {
+        UpdateGeometry();
+        m_geometryRevision = m_model->GetGeometryRevision();
+    }
+    if(m_pickRevision != m_model->GetPickRevision())
+    {
+        UpdatePickColors();
+        m_pickRevision = m_model->GetPickRevision();
+    }
+    if(m_batches.empty())
+        return;
+
+    SetupModelView();
+
+    m_gl.glEnableClientState(GL_VERTEX_ARRAY);
+    m_gl.glEnableClientState(GL_NORMAL_ARRAY);
+    m_gl.glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    m_gl.glEnableClientState(GL_COLOR_ARRAY);
+
+    m_colorBuffer.bind();
+    m_gl.glColorPointer(4, GL_UNSIGNED_BYTE, 0, nullptr);
+    m_vertexBuffer.bind();
+    m_gl.glVertexPointer(3, GL_FLOAT, sizeof(SVertex), reinterpret_cast<const void*>(offsetof(SVertex, x)));
+    m_gl.glNormalPointer(GL_FLOAT, sizeof(SVertex), reinterpret_cast<const void*>(offsetof(SVertex, nx)));
+    m_gl.glTexCoordPointer(2, GL_FLOAT, sizeof(SVertex), reinterpret_cast<const void*>(offsetof(SVertex, u)));
+
+    const bool renTexture = CSettings::GetInstance().GetRenderFlags() & CSettings::R_TEXTR;
+    for(const SBatch& batch : m_batches)
+    {
+        QOpenGLTexture* tex = nullptr;
+        if(renTexture)
+        {
+            auto it = m_textures.find(batch.material);
+            if(it != m_textures.end())
+                tex = it->second.get();
+        }
+        if(tex)
+            tex->bind();
+        m_gl.glDrawArrays(GL_TRIANGLES, batch.first, batch.count);
+        if(tex)
+            tex->release();
+    }
+
+    m_vertexBuffer.release();
+
+    m_gl.glDisableClientState(GL_COLOR_ARRAY);
+    m_gl.glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    m_gl.glDisableClientState(GL_NORMAL_ARRAY);
+    m_gl.glDisableClientState(GL_VERTEX_ARRAY);
+
+    m_gl.glColor3ub(255, 255, 255);
+}
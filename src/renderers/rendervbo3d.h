@@ -0,0 +1,62 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef RENDERVBO3D_H
+#define RENDERVBO3D_H
+#include <QOpenGLBuffer>
+#include <unordered_set>
+#include <vector>
+#include <cstdint>
+#include "renderlegacy3d.h"
+
+//Uploads model once into material-sorted vertex buffer;
+//picked triangles are highlighted through separate color buffer
+class CRenderer3DVBO : public CRenderer3DLegacy
+{
+public:
+    CRenderer3DVBO(QOpenGLFunctions_2_0& gl);
+    virtual ~CRenderer3DVBO();
+
+    void    SetModel(const CMesh* mdl) override;
+
+protected:
+    void    DrawModel() const override;
+
+private:
+    struct SBatch
+    {
+        unsigned    material;
+        GLint       first;
+        GLsizei     count;
+    };
+
+    void    UpdateGeometry() const;
+    void    UpdatePickColors() const;
+    void    SetTriangleColor(std::size_t tri, bool picked, std::size_t& dirtyFirst, std::size_t& dirtyLast) const;
+
+    mutable QOpenGLBuffer               m_vertexBuffer;
+    mutable QOpenGLBuffer               m_colorBuffer;
+    mutable std::vector<SBatch>         m_batches;
+    mutable std::vector<GLuint>         m_triSlots; //triangle index -> position in buffers
+    mutable std::vector<GLubyte>        m_colors;
+    mutable std::unordered_set
+        <std::size_t>                   m_uploadedPicks;
+    mutable std::uint64_t               m_geometryRevision = 0;
+    mutable std::uint64_t               m_pickRevision = 0;
+};
+
+#endif // RENDERVBO3D_H
@@ -21,6 +21,8 @@
 #include "settings.h"
 #include "notification/hub.h"
 
+bool CSettings::ms_persistent = true;
+
 CSettings::CSettings() :
     QObject(nullptr),
     ttStyle(""),
@@ -38,14 +40,19 @@ CSettings::CSettings() :
     m_stippleLoop(2),
     m_detachAngle(70),
     m_foldMaxFlatAngle(1),
+    m_rendererBackend(RB_VBO),
+    m_packingAlgorithm(PA_MAXRECTS),
+    m_undoMemoryLimit(64u),
     m_loading(false)
 {
-    LoadSettings();
+    if(ms_persistent)
+        LoadSettings();
 }
 
 CSettings::~CSettings()
 {
-    SaveSettings();
+    if(ms_persistent)
+        SaveSettings();
 }
 
 void CSettings::LoadSettings()
@@ -88,6 +95,11 @@ CSettings& CSettings::GetInstance()
     return s;
 }
 
+void CSettings::SetPersistent(bool persistent)
+{
+    ms_persistent = persistent;
+}
+
 unsigned char CSettings::GetRenderFlags() const
 {
     return m_renFlags;
@@ -248,3 +260,39 @@ void CSettings::SetFoldMaxFlatAngle(unsigned char aFoldFlatAngle)
     if(!m_loading)
         NOTIFY(Changed);
 }
+
+CSettings::RendererBackend CSettings::GetRendererBackend() const
+{
+    return m_rendererBackend;
+}
+
+void CSettings::SetRendererBackend(CSettings::RendererBackend aBackend)
+{
+    m_rendererBackend = aBackend;
+    if(!m_loading)
+        NOTIFY(Changed);
+}
+
+unsigned CSettings::GetUndoMemoryLimit() const
+{
+    return m_undoMemoryLimit;
+}
+
+void CSettings::SetUndoMemoryLimit(unsigned aMegabytes)
+{
+    m_undoMemoryLimit = aMegabytes;
+    if(!m_loading)
+        NOTIFY(Changed);
+}
+
+CSettings::PackingAlgorithm CSettings::GetPackingAlgorithm() const
+{
+    return m_packingAlgorithm;
+}
+
+void CSettings::SetPackingAlgorithm(CSettings::PackingAlgorithm aAlgorithm)
+{
+    m_packingAlgorithm = aAlgorithm;
+    if(!m_loading)
+        NOTIFY(Changed);
+}
@@ -38,6 +38,20 @@ public:
         IF_PNG
     };
 
+    enum RendererBackend
+    {
+        RB_LEGACY = 0,
+        RB_VBO
+    };
+
+    enum PackingAlgorithm
+    {
+        PA_FCNR = 0,
+        PA_MAXRECTS,
+        PA_SKYLINE,
+        PA_NESTING
+    };
+
     CSettings(const CSettings&) = delete;
     CSettings(CSettings&&) = delete;
     CSettings& operator=(const CSettings&) = delete;
@@ -53,6 +67,8 @@ public:
     static const unsigned char R_GRID  = (1u << 5);
 
     static CSettings&    GetInstance();
+    //must be called before first GetInstance(); non-persistent settings neither read nor write config file
+    static void          SetPersistent(bool persistent);
 
     Q_PROPERTY(unsigned char maxFlatAngle READ GetFoldMaxFlatAngle WRITE SetFoldMaxFlatAngle)
     unsigned char        GetFoldMaxFlatAngle() const;
@@ -103,6 +119,20 @@ public:
     unsigned char        GetDetachAngle() const;
     void                 SetDetachAngle(unsigned char aDetachAngle);
 
+    //takes effect when render windows are (re)initialized
+    Q_PROPERTY(int rendererBackend READ GetRendererBackendI WRITE SetRendererBackendI)
+    RendererBackend      GetRendererBackend() const;
+    void                 SetRendererBackend(RendererBackend aBackend);
+
+    //megabytes of undo history
+    Q_PROPERTY(unsigned undoMemoryLimit READ GetUndoMemoryLimit WRITE SetUndoMemoryLimit)
+    unsigned             GetUndoMemoryLimit() const;
+    void                 SetUndoMemoryLimit(unsigned aMegabytes);
+
+    Q_PROPERTY(int packingAlgorithm READ GetPackingAlgorithmI WRITE SetPackingAlgorithmI)
+    PackingAlgorithm     GetPackingAlgorithm() const;
+    void                 SetPackingAlgorithm(PackingAlgorithm aAlgorithm);
+
     Q_PROPERTY(QString ttStyle     MEMBER ttStyle)
     QString            ttStyle;
     Q_PROPERTY(bool    ttCollapsed MEMBER ttCollapsed)
@@ -113,6 +143,10 @@ private:
 
     int GetImageFormatI() const { return (int)GetImageFormat(); }
     void SetImageFormatI(int aFormat) { SetImageFormat((ImageFormat)aFormat); }
+    int GetRendererBackendI() const { return (int)GetRendererBackend(); }
+    void SetRendererBackendI(int aBackend) { SetRendererBackend((RendererBackend)aBackend); }
+    int GetPackingAlgorithmI() const { return (int)GetPackingAlgorithm(); }
+    void SetPackingAlgorithmI(int aAlgorithm) { SetPackingAlgorithm((PackingAlgorithm)aAlgorithm); }
 
     void LoadSettings();
     void SaveSettings();
@@ -131,8 +165,13 @@ private:
     unsigned      m_stippleLoop;
     unsigned char m_detachAngle;
     unsigned char m_foldMaxFlatAngle;
+    RendererBackend m_rendererBackend;
+    PackingAlgorithm m_packingAlgorithm;
+    unsigned      m_undoMemoryLimit;
 
     bool          m_loading;
+
+    static bool   ms_persistent;
 };
 
 #endif // SETTINGS_H
@@ -0,0 +1,125 @@
+/*
+    Ivo - a free software for unfolding 3D models and papercrafting
+    Copyright (C) 2015-2018 Oleksii Sierov (seriousalexej@gmail.com)
+	
+    Ivo is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ivo is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Ivo.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include "threading/parallelfor.h"
+
+namespace
+{
+//ranges are claimed by whichever thread comes first, including the calling one;
+//helpers that start after all ranges are claimed return at once, so state is shared with them
+struct SLoopState
+{
+    std::function<void(std::size_t, std::size_t)> body;
+    std::size_t                                    count;
+    std::size_t                                    rangeSize;
+    std::size_t                                    numRanges;
+    std::atomic<std::size_t>                       next;
+    std::size_t                                    finished = 0;
+    std::exception_ptr                             error;
+    QMutex                                         mutex;
+    QWaitCondition                                 allFinished;
+
+    void RunRanges()
+    {
+        for(;;)
+        {
+            const std::size_t begin = next.fetch_add(rangeSize);
+            if(begin >= count)
+                return;
+
+            std::exception_ptr rangeError;
+            try
+            {
+                body(begin, std::min(count, begin + rangeSize));
+            }
+            catch(...)
+            {
+                rangeError = std::current_exception();
+            }
+
+            QMutexLocker lock(&mutex);
+            if(rangeError && !error)
+                error = rangeError;
+            if(++finished == numRanges)
+                allFinished.wakeAll();
+        }
+    }
+};
+
+class CRangeTask : public QRunnable
+{
+public:
+    explicit CRangeTask(const std::shared_ptr<SLoopState>& state) :
+        m_state(state)
+    {}
+
+    void run() override
+    {
+        m_state->RunRanges();
+    }
+
+private:
+    std::shared_ptr<SLoopState> m_state;
+};
+}
+
+void ParallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body)
+{
+    const std::size_t threads = static_cast<std::size_t>(std::max(1, QThread::idealThreadCount()));
+    grain = std::max<std::size_t>(grain, 1u);
+    if(count <= grain || threads == 1)
+    {
+        if(count > 0)
+            body(0, count);
+        return;
+    }
+
+    //few ranges per thread to even out uneven work
+    const std::size_t rangeSize = std::max(grain, (count + threads * 4 - 1) / (threads * 4));
+
+    std::shared_ptr<SLoopState> state = std::make_shared<SLoopState>();
+    state->body = body;
+    state->count = count;
+    state->rangeSize = rangeSize;
+    state->numRanges = (count + rangeSize - 1) / rangeSize;
+    state->next = 0;
+
+    //global pool keeps its threads between calls; calling thread works too and waits only
+    //for ranges already running elsewhere, so nested calls from pool threads cannot deadlock
+    QThreadPool* pool = QThreadPool::globalInstance();
+    const std::size_t helpers = std::min(threads, state->numRanges) - 1;
+    for(std::size_t i=0; i<helpers; ++i)
+        pool->start(new CRangeTask(state));
+
+    state->RunRanges();
+
+    QMutexLocker lock(&state->mutex);
+    while(state->finished != state->numRanges)
+        state->allFinished.wait(&state->mutex);
+    if(state->error)
+        std::rethrow_exception(state->error);
+}